@@ -2,78 +2,166 @@
 #include "input.h"
 
 #include "util/util.h"
-#include "util/position.h"
-
-#include <range/v3/all.hpp>
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <print>
+#include <span>
 #include <vector>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
 
 namespace aoc2024::day10
 {
 using Map = std::vector<std::string>;
-namespace position = util::position;
-using Position = util::position::Position;
 
-bool inBounds(const Map& map, const Position& position)
-{
-    return position.y >= 0 && position.y < std::ssize(map) && position.x >= 0
-           && position.x < std::ssize(map[0]);
-}
+constexpr int summitHeight = 9;
 
-auto value(const Map& map, const Position& position)
-{
-    return map[position.y][position.x];
-}
-namespace part1
+/**
+ * The map flattened into per-cell heights, with cells bucketed by height
+ * (a counting sort by digit), so every level can be processed as a linear
+ * sweep without any hashing. Impassable cells have no height and belong to
+ * no level.
+ */
+struct Topography
 {
+    static constexpr std::int8_t impassable = -1;
 
-int solve(const Map& map)
-{
-    using namespace ::ranges;
-    using RouteStartTracker = std::unordered_set<Position>;
-    using WorkStep = std::unordered_map<Position, RouteStartTracker>;
-    auto currentStep = [&]
+    explicit Topography(const Map& map)
+        : width{static_cast<int>(std::ssize(map[0]))}
+        , height{static_cast<int>(std::ssize(map))}
+        , heights(static_cast<std::size_t>(width) * height, impassable)
     {
-        return position::all(std::ssize(map), std::ssize(map[0]))
-               | views::filter(std::bind_front(std::equal_to{}, '0'),
-                               std::bind_front(value, std::cref(map)))
-               | views::transform(
-                   [](const auto& pos) -> WorkStep::value_type
-                   {
-                       return {pos, {pos}};
-                   })
-               | to<WorkStep>;
-    }();
-
-    for (auto i = '1'; i <= '9'; ++i)
-    {
-        auto nextMoves =
-            views::cartesian_product(currentStep, util::position::directions)  //
-            | views::transform(
-                [](const auto& pair) -> WorkStep::value_type
-                {
-                    const auto& [pos, dir] = pair;
-                    return {pos.first + dir, pos.second};
-                })
-            | views::filter(std::bind_front(inBounds, std::cref(map)),
-                            &WorkStep::value_type::first)
-            | views::filter(
-                [&](const auto& val)
+        std::array<std::size_t, summitHeight + 2> counts{};
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                if (auto ch = map[y][x]; ch >= '0' && ch <= '9')
                 {
-                    return value(map, val.first) == i;
-                });
+                    heights[y * width + x] = static_cast<std::int8_t>(ch - '0');
+                    ++counts[ch - '0' + 1];
+                }
+            }
+        }
+        std::partial_sum(std::begin(counts), std::end(counts), std::begin(levelStart));
 
-        WorkStep nextStep;
-        for (const auto& [position, routeSources] : nextMoves)
-            nextStep[position].insert(std::begin(routeSources), std::end(routeSources));
+        cells.resize(levelStart.back());
+        auto next = levelStart;
+        for (int cell = 0; cell < std::ssize(heights); ++cell)
+        {
+            if (heights[cell] != impassable)
+                cells[next[heights[cell]]++] = cell;
+        }
+    }
+
+    std::span<const int> level(int elevation) const
+    {
+        return std::span{cells}.subspan(levelStart[elevation],
+                                        levelStart[elevation + 1] - levelStart[elevation]);
+    }
+
+    std::size_t cellCount() const { return std::size(heights); }
 
-        currentStep = std::move(nextStep);
+    /**
+     * Calls `func(neighbour)` for every orthogonal neighbour of `cell` that is
+     * exactly `elevation` high.
+     */
+    void forEachNeighbour(int cell, int elevation, auto func) const
+    {
+        auto x = cell % width;
+        auto visit = [&](int neighbour)
+        {
+            if (heights[neighbour] == elevation)
+                func(neighbour);
+        };
+        if (cell >= width)
+            visit(cell - width);
+        if (cell + width < std::ssize(heights))
+            visit(cell + width);
+        if (x > 0)
+            visit(cell - 1);
+        if (x + 1 < width)
+            visit(cell + 1);
     }
-    return accumulate(currentStep | views::values, 0, std::plus{}, &RouteStartTracker::size);
+
+    int width = 0;
+    int height = 0;
+    std::vector<std::int8_t> heights;
+    std::vector<int> cells;  // ordered by height
+    std::array<std::size_t, summitHeight + 2> levelStart{};
+};
+
+namespace part1
+{
+/**
+ * Reachable summits are tracked as bitmasks of `Words` 64-bit words per
+ * cell, one bit per summit. Summits are numbered and processed in blocks of
+ * 64 * Words: for each block the masks are propagated from the summits down
+ * to the trailheads (each cell ORs the masks of its neighbours one level
+ * higher), and popcounts are summed at the trailheads. Memory stays at one
+ * mask per cell per worker regardless of the number of summits, and blocks
+ * are independent, so they are processed in parallel.
+ */
+template <std::size_t Words = 8>
+std::size_t countReachableSummits(const Topography& topography)
+{
+    using SummitMask = std::array<std::uint64_t, Words>;
+    constexpr std::size_t blockSize = 64 * Words;
+
+    auto summits = topography.level(summitHeight);
+    auto blocks = (std::size(summits) + blockSize - 1) / blockSize;
+    auto workers = util::parallel::workerCount(blocks);
+    std::vector<std::vector<SummitMask>> masks(workers);
+    std::vector<std::size_t> counts(workers);
+
+    util::parallel::forEachIndex(  //
+        blocks,
+        [&](std::size_t block, std::size_t worker)
+        {
+            auto& mask = masks[worker];
+            mask.resize(topography.cellCount());
+
+            auto first = block * blockSize;
+            for (std::size_t id = 0; id < std::size(summits); ++id)
+            {
+                mask[summits[id]] = {};
+                if (id >= first && id < first + blockSize)
+                    mask[summits[id]][(id - first) / 64] = std::uint64_t{1} << (id % 64);
+            }
+
+            for (auto elevation = summitHeight - 1; elevation >= 0; --elevation)
+            {
+                for (auto cell : topography.level(elevation))
+                {
+                    SummitMask reachable{};
+                    topography.forEachNeighbour(  //
+                        cell,
+                        elevation + 1,
+                        [&](int neighbour)
+                        {
+                            for (std::size_t word = 0; word < Words; ++word)
+                                reachable[word] |= mask[neighbour][word];
+                        });
+                    mask[cell] = reachable;
+                }
+            }
+
+            for (auto cell : topography.level(0))
+            {
+                for (auto word : mask[cell])
+                    counts[worker] += std::popcount(word);
+            }
+        });
+    return std::accumulate(std::begin(counts), std::end(counts), std::size_t{0});
+}
+
+int solve(const Map& map)
+{
+    return static_cast<int>(countReachableSummits(Topography{map}));
 }
 void test()
 {
@@ -130,50 +218,34 @@ void solution()
 
 namespace part2
 {
-
-int solve(const Map& map)
+/**
+ * Number of distinct trails ending in each cell, swept level by level from
+ * the trailheads up over a flat array.
+ */
+std::uint64_t solve(const Map& map)
 {
-    using namespace ::ranges;
-    using WorkStep = std::unordered_map<Position, int>;
+    Topography topography{map};
+    std::vector<std::uint64_t> trails(topography.cellCount());
+    for (auto cell : topography.level(0))
+        trails[cell] = 1;
 
-    auto currentStep = [&]
-    {
-        return position::all(std::ssize(map), std::ssize(map[0]))
-               | views::filter(std::bind_front(std::equal_to{}, '0'),
-                               std::bind_front(value, std::cref(map)))
-               | views::transform(
-                   [](const auto& pos) -> WorkStep::value_type
-                   {
-                       return {pos, 1};
-                   })
-               | to<WorkStep>;
-    }();
-
-    for (auto i = '1'; i <= '9'; ++i)
+    for (auto elevation = 1; elevation <= summitHeight; ++elevation)
     {
-        auto nextMoves =
-            views::cartesian_product(currentStep, util::position::directions)  //
-            | views::transform(
-                [](const auto& pair) -> WorkStep::value_type
-                {
-                    const auto& [pos, dir] = pair;
-                    return {pos.first + dir, pos.second};
-                })
-            | views::filter(std::bind_front(inBounds, std::cref(map)),
-                            &WorkStep::value_type::first)
-            | views::filter(
-                [&](const auto& val)
-                {
-                    return value(map, val.first) == i;
-                });
-
-        WorkStep nextStep;
-        for (const auto& [position, counter] : nextMoves)
-            nextStep[position] += counter;
-
-        currentStep = std::move(nextStep);
+        for (auto cell : topography.level(elevation))
+        {
+            topography.forEachNeighbour(cell,
+                                        elevation - 1,
+                                        [&](int neighbour)
+                                        {
+                                            trails[cell] += trails[neighbour];
+                                        });
+        }
     }
-    return accumulate(currentStep | views::values, 0, std::plus{});
+
+    std::uint64_t result = 0;
+    for (auto cell : topography.level(summitHeight))
+        result += trails[cell];
+    return result;
 }
 
 void test()
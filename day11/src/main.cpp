@@ -6,7 +6,11 @@
 
 #include <boost/unordered/unordered_flat_map.hpp>
 
-#include <cstdlib>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <numeric>
 #include <span>
 #include <vector>
 #include <unordered_map>
@@ -37,8 +41,7 @@ std::uint64_t evolvePebbles(std::span<std::uint64_t> input, std::uint64_t times)
                 nextGeneration[1] += count;
             else if (auto digits = countDigits(number); isEven(digits))
             {
-                auto [div, mod] =
-                    std::ldiv(number, std::uint64_t(std::pow(10, digits / 2)));
+                auto [div, mod] = util::splitDigits(number, digits / 2);
                 nextGeneration[div] += count;
                 nextGeneration[mod] += count;
             }
@@ -88,8 +91,7 @@ std::uint64_t evolvePebbles1(std::span<std::uint64_t> input, std::uint64_t times
                 nextGeneration.emplace_back(1, count);
             else if (auto digits = countDigits(number); isEven(digits))
             {
-                auto [div, mod] =
-                    std::ldiv(number, std::uint64_t(std::pow(10, digits / 2)));
+                auto [div, mod] = util::splitDigits(number, digits / 2);
                 nextGeneration.emplace_back(div, count);
                 nextGeneration.emplace_back(mod, count);
             }
@@ -122,6 +124,326 @@ std::uint64_t evolvePebbles1(std::span<std::uint64_t> input, std::uint64_t times
     return accumulate(currentGeneration, std::uint64_t{0}, std::plus{}, &PebleCounter::second);
 }
 
+/**
+ * Stone values interned to dense ids, with the successors of every id cached
+ * after its first blink. The number of distinct stones converges to a few
+ * thousand, so once the graph stops growing a blink needs no hashing at all.
+ */
+class StoneGraph
+{
+public:
+    static constexpr auto none = std::numeric_limits<std::uint32_t>::max();
+    using Successors = std::array<std::uint32_t, 2>;
+
+    std::uint32_t intern(std::uint64_t stone)
+    {
+        auto [it, inserted] =
+            ids.try_emplace(stone, static_cast<std::uint32_t>(std::size(values)));
+        if (inserted)
+            values.push_back(stone);
+        return it->second;
+    }
+
+    /**
+     * Caches successors of every id interned so far. Ids that first appear
+     * as successors here get resolved by the next call.
+     */
+    void resolve()
+    {
+        for (auto end = std::size(values); std::size(successors) < end;)
+            successors.push_back(blink(values[std::size(successors)]));
+    }
+
+    /**
+     * Resolves until no new stones appear, i.e. the graph is closed.
+     */
+    void close()
+    {
+        while (std::size(successors) < std::size(values))
+            resolve();
+    }
+
+    const Successors& next(std::uint32_t id) const { return successors[id]; }
+    std::size_t size() const { return std::size(values); }
+
+private:
+    Successors blink(std::uint64_t stone)
+    {
+        if (stone == 0)
+            return {intern(1), none};
+        if (auto digits = countDigits(stone); isEven(digits))
+        {
+            auto [div, mod] = util::splitDigits(stone, digits / 2);
+            return {intern(div), intern(mod)};
+        }
+        return {intern(stone * 2024), none};
+    }
+
+    boost::unordered_flat_map<std::uint64_t, std::uint32_t> ids;
+    std::vector<std::uint64_t> values;
+    std::vector<Successors> successors;
+};
+
+/**
+ * Number of pebbles per stone id. A blink is a sparse matrix-vector product
+ * with the cached successor table of a StoneGraph: at most two successors
+ * per id. Counts grow exponentially, so `Count` must be wide enough (or
+ * modular) for the number of blinks requested.
+ */
+template <typename Count = std::uint64_t>
+class PebbleCounts
+{
+public:
+    PebbleCounts(StoneGraph& graph, std::span<const std::uint64_t> input)
+        : graph{graph}
+    {
+        for (auto pebble : input)
+        {
+            auto id = graph.intern(pebble);
+            if (id >= std::size(counts))
+                counts.resize(id + 1);
+            counts[id] += Count{1};
+        }
+    }
+
+    void blink()
+    {
+        graph.resolve();
+        next.assign(graph.size(), Count{0});
+        for (std::uint32_t id = 0; id < std::size(counts); ++id)
+        {
+            if (counts[id] == Count{0})
+                continue;
+            auto [first, second] = graph.next(id);
+            next[first] += counts[id];
+            if (second != StoneGraph::none)
+                next[second] += counts[id];
+        }
+        std::swap(counts, next);
+    }
+
+    Count total() const
+    {
+        return std::accumulate(std::begin(counts), std::end(counts), Count{0});
+    }
+
+private:
+    StoneGraph& graph;
+    std::vector<Count> counts;
+    std::vector<Count> next;
+};
+
+template <typename Count = std::uint64_t>
+Count evolvePebbles2(std::span<const std::uint64_t> input, std::uint64_t times)
+{
+    StoneGraph graph;
+    PebbleCounts<Count> counts{graph, input};
+    for (std::uint64_t i = 0; i < times; ++i)
+        counts.blink();
+    return counts.total();
+}
+
+/**
+ * Integers modulo the Mersenne prime 2^61 - 1. Totals below ~2.3e18 come out
+ * exact, larger ones are only known modulo the prime.
+ */
+struct ModularCount
+{
+    static constexpr std::uint64_t modulus = (std::uint64_t{1} << 61) - 1;
+
+    constexpr ModularCount() = default;
+    constexpr ModularCount(std::uint64_t number)
+        : value{number % modulus}
+    {}
+
+    constexpr bool operator==(const ModularCount& other) const = default;
+
+    constexpr ModularCount& operator+=(ModularCount other)
+    {
+        value += other.value;
+        if (value >= modulus)
+            value -= modulus;
+        return *this;
+    }
+
+    constexpr ModularCount& operator-=(ModularCount other)
+    {
+        value += modulus - other.value;
+        if (value >= modulus)
+            value -= modulus;
+        return *this;
+    }
+
+    constexpr ModularCount& operator*=(ModularCount other)
+    {
+        __extension__ using Wide = unsigned __int128;
+        auto product = Wide{value} * other.value;
+        // 2^61 == 1 (mod 2^61 - 1): fold the high bits onto the low ones
+        value = static_cast<std::uint64_t>(product & modulus)
+                + static_cast<std::uint64_t>(product >> 61);
+        if (value >= modulus)
+            value -= modulus;
+        return *this;
+    }
+
+    friend constexpr ModularCount operator+(ModularCount lhs, ModularCount rhs)
+    {
+        return lhs += rhs;
+    }
+    friend constexpr ModularCount operator-(ModularCount lhs, ModularCount rhs)
+    {
+        return lhs -= rhs;
+    }
+    friend constexpr ModularCount operator*(ModularCount lhs, ModularCount rhs)
+    {
+        return lhs *= rhs;
+    }
+
+    constexpr ModularCount inverse() const
+    {
+        ModularCount result{1};
+        ModularCount base = *this;
+        for (auto exponent = modulus - 2; exponent > 0; exponent >>= 1)
+        {
+            if (exponent & 1)
+                result *= base;
+            base *= base;
+        }
+        return result;
+    }
+
+    std::uint64_t value = 0;
+};
+
+/**
+ * Pebble counts after any number of blinks, modulo ModularCount::modulus.
+ *
+ * Over the closed stone graph a blink is a fixed linear map M, and the total
+ * after N blinks is 1^T * M^N * v. Squaring M directly is out of reach: the
+ * graph has thousands of stones and every dense product is O(n^3). By
+ * Cayley-Hamilton the totals satisfy a linear recurrence of order d <= n
+ * instead. It is recovered once with Berlekamp-Massey from the first 2n
+ * totals; a query then raises x to the N-th power modulo the recurrence's
+ * characteristic polynomial by repeated squaring and applies the result to
+ * the first d totals, O(d^2 log N) per query.
+ */
+class BlinkRecurrence
+{
+public:
+    explicit BlinkRecurrence(std::span<const std::uint64_t> input)
+    {
+        StoneGraph graph;
+        PebbleCounts<ModularCount> counts{graph, input};
+        graph.close();
+        for (std::size_t i = 0; i < 2 * graph.size(); ++i)
+        {
+            totals.push_back(counts.total());
+            counts.blink();
+        }
+        findRecurrence();
+    }
+
+    ModularCount count(std::uint64_t blinks) const
+    {
+        if (blinks < std::size(totals))
+            return totals[blinks];
+        if (std::empty(coefficients))
+            return 0;
+
+        Polynomial base(std::size(coefficients));
+        if (std::size(coefficients) > 1)
+            base[1] = 1;
+        else
+            base[0] = coefficients[0];
+
+        Polynomial power(std::size(coefficients));
+        power[0] = 1;
+        for (; blinks > 0; blinks >>= 1)
+        {
+            if (blinks & 1)
+                power = multiply(power, base);
+            base = multiply(base, base);
+        }
+
+        ModularCount result;
+        for (std::size_t i = 0; i < std::size(power); ++i)
+            result += power[i] * totals[i];
+        return result;
+    }
+
+    std::size_t order() const { return std::size(coefficients); }
+
+    /** Blink counts below this are looked up; the recurrence answers the rest. */
+    std::size_t precomputed() const { return std::size(totals); }
+
+private:
+    using Polynomial = std::vector<ModularCount>;
+
+    /**
+     * Berlekamp-Massey: the shortest `coefficients` such that
+     * totals[k] == sum(coefficients[i] * totals[k - 1 - i]) for all k >= order.
+     */
+    void findRecurrence()
+    {
+        Polynomial current{1};
+        Polynomial previous{1};
+        ModularCount previousDiscrepancy{1};
+        std::size_t length = 0;
+        std::size_t shift = 1;
+        for (std::size_t n = 0; n < std::size(totals); ++n, ++shift)
+        {
+            auto discrepancy = totals[n];
+            for (std::size_t i = 1; i <= length; ++i)
+                discrepancy += current[i] * totals[n - i];
+            if (discrepancy == ModularCount{0})
+                continue;
+
+            auto factor = discrepancy * previousDiscrepancy.inverse();
+            auto saved = current;
+            current.resize(std::max(std::size(current), std::size(previous) + shift));
+            for (std::size_t i = 0; i < std::size(previous); ++i)
+                current[i + shift] -= factor * previous[i];
+
+            if (2 * length <= n)
+            {
+                length = n + 1 - length;
+                previous = std::move(saved);
+                previousDiscrepancy = discrepancy;
+                shift = 0;
+            }
+        }
+
+        current.resize(length + 1);
+        coefficients.clear();
+        for (std::size_t i = 1; i <= length; ++i)
+            coefficients.push_back(ModularCount{0} - current[i]);
+    }
+
+    /**
+     * lhs * rhs modulo x^d - sum(coefficients[i] * x^(d - 1 - i)).
+     */
+    Polynomial multiply(const Polynomial& lhs, const Polynomial& rhs) const
+    {
+        auto order = std::size(coefficients);
+        Polynomial product(2 * order - 1);
+        for (std::size_t i = 0; i < order; ++i)
+        {
+            for (std::size_t j = 0; j < order; ++j)
+                product[i + j] += lhs[i] * rhs[j];
+        }
+        for (auto k = 2 * order - 2; k >= order; --k)
+        {
+            for (std::size_t i = 0; i < order; ++i)
+                product[k - 1 - i] += product[k] * coefficients[i];
+        }
+        product.resize(order);
+        return product;
+    }
+
+    std::vector<ModularCount> totals;  // totals after 0, 1, 2... blinks
+    Polynomial coefficients;
+};
+
 namespace part1
 {
 
@@ -132,6 +454,14 @@ void test()
         std::vector<std::uint64_t> input = {125, 17};
         auto solution = evolvePebbles(input, 25);
         fmt::print("Part I Test1: {}\n", solution);
+        assert(solution == 55312);
+        assert(evolvePebbles2(input, 25) == solution);
+        BlinkRecurrence recurrence{input};
+        assert(recurrence.count(25).value == solution);
+        // past the precomputed totals, against plain modular evolution
+        auto table = recurrence.precomputed();
+        for (auto blinks : {table, table + 1, std::size_t{3000}})
+            assert(recurrence.count(blinks) == evolvePebbles2<ModularCount>(input, blinks));
     }
 }
 
@@ -156,6 +486,24 @@ void solve2()
     auto solution = evolvePebbles1(input, 75);
     fmt::print("Part II Solution2: {}\n", solution);  // 207961583799296 - 9-11ms
 }
+void solve3()
+{
+    std::vector<std::uint64_t> input{64554, 35, 906, 6, 6960985, 5755, 975820, 0};
+    auto solution = evolvePebbles2(input, 75);
+    fmt::print("Part II Solution3: {}\n", solution);  // 207961583799296
+}
+void solve4()
+{
+    std::vector<std::uint64_t> input{64554, 35, 906, 6, 6960985, 5755, 975820, 0};
+    BlinkRecurrence recurrence{input};
+    auto solution = recurrence.count(75).value;
+    fmt::print("Part II Solution4: {} (recurrence order {})\n", solution, recurrence.order());
+    assert(solution == 207961583799296);
+    auto blinks = recurrence.precomputed() + 1;
+    assert(recurrence.count(blinks) == evolvePebbles2<ModularCount>(input, blinks));
+    fmt::print("After 10^12 blinks: {} mod 2^61-1\n",
+               recurrence.count(1'000'000'000'000).value);
+}
 }  // namespace part2
 }  // namespace aoc2024::day11
 
@@ -167,5 +515,7 @@ int main()
     util::withTimer("part1::solve", part1::solve);
     util::withTimer("part2::solve", part2::solve);
     util::withTimer("part2::solve2", part2::solve2);
+    util::withTimer("part2::solve3", part2::solve3);
+    util::withTimer("part2::solve4", part2::solve4);
     return 0;
 }
\ No newline at end of file
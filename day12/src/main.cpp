@@ -1,157 +1,460 @@
 #include "input.h"
 #include "util/util.h"
-#include "util/position.h"
-#include "util/functional.h"
-
-#include <range/v3/all.hpp>
 
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
-#include <vector>
-#include <string>
-#include <unordered_set>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <numeric>
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
 namespace aoc2024::day12
 {
-namespace position = aoc2024::util::position;
 using Map = std::vector<std::string>;
 
-constexpr auto inBounds(const Map& input, const position::Position& pos)
-{
-    return pos.y >= 0 && pos.y < std::ssize(input) && pos.x >= 0
-           && pos.x < std::ssize(input[pos.y]);
-}
-
 struct Metrics
 {
-    char c = 0;  // useful for debug
     std::uint64_t square = 0;
     std::uint64_t perimeter = 0;
+    std::uint64_t sides = 0;  // equals the number of corners
+
+    Metrics& operator+=(const Metrics& other)
+    {
+        square += other.square;
+        perimeter += other.perimeter;
+        sides += other.sides;
+        return *this;
+    }
 };
 
-constexpr auto value(const Metrics& metrics)
+constexpr auto format_as(const Metrics& metrics)
 {
-    return metrics.square * metrics.perimeter;
+    return std::tie(metrics.square, metrics.perimeter, metrics.sides);
 }
 
-constexpr auto format_as(const Metrics& metrics)
+/**
+ * Fence prices summed over regions: area times perimeter (part I) and area
+ * times number of sides (part II).
+ */
+struct Prices
 {
-    return std::tie(metrics.c, metrics.square, metrics.perimeter);
-}
+    std::uint64_t perimeter = 0;
+    std::uint64_t sides = 0;
+
+    Prices& operator+=(const Metrics& region)
+    {
+        perimeter += region.square * region.perimeter;
+        sides += region.square * region.sides;
+        return *this;
+    }
+
+    Prices& operator+=(const Prices& other)
+    {
+        perimeter += other.perimeter;
+        sides += other.sides;
+        return *this;
+    }
+
+    bool operator==(const Prices&) const = default;
+};
 
-struct Filler
+/**
+ * Single pass connected-component labelling of a garden map, fed one row at
+ * a time. Only the previous and the current row (plants and labels) are
+ * kept. Cells get provisional labels joined with union-find as same-plant
+ * neighbours above and to the left are discovered, and every label carries
+ * the area, perimeter and corner count accumulated so far. After each row
+ * the labels are compacted: a region no longer present in the current row
+ * cannot grow, so it is priced and its slot reused, which bounds the label
+ * arrays by two rows' worth of cells.
+ *
+ * Edges and corners only depend on a 2x2 window, so they are counted on the
+ * seam between the previous and the current row: the plants outside the map
+ * are a sentinel that matches nothing.
+ *
+ * A labeller can also cover just a band of the map: the rows directly above
+ * and below the band are then passed as context, which counts the band's own
+ * edges and corners correctly without labelling the neighbouring cells.
+ * Regions touching the band's first or last row may continue in the next
+ * band, so they are kept open rather than priced.
+ */
+class RegionLabeller
 {
-    Filler(const Map& input)
-        : map{input}
-        , seen{std::size(input), std::vector<int>(std::ssize(input), unseen)}
-    {}
+public:
+    using Label = std::uint32_t;
+    static constexpr Label noLabel = std::numeric_limits<Label>::max();
+
+    /**
+     * Prices of the regions a labeller closed, plus the regions left open on
+     * the band's borders, densely numbered, with the region of every cell of
+     * its first and last row for stitching bands together.
+     */
+    struct Band
+    {
+        Prices closed;
+        std::vector<Metrics> open;
+        std::vector<Label> firstRow;
+        std::vector<Label> lastRow;
+    };
+
+    /**
+     * Sets the row right above the band; must precede the first addRow.
+     */
+    void addContext(std::string_view row)
+    {
+        previous.assign(row);
+        previousLabels.assign(std::size(row), noLabel);
+        keepFirstRow = true;
+    }
 
-    using Result = std::optional<Metrics>;
-    Result operator()(const position::Position& pos)
+    void addRow(std::string_view row)
     {
-        if (seen[pos.y][pos.x] != unseen)
-            return std::nullopt;
+        if (std::empty(previous))
+        {
+            previous.assign(std::size(row), outside);
+            previousLabels.assign(std::size(row), noLabel);
+        }
+        current.assign(row);
+        currentLabels.resize(std::size(row));
 
-        //        return recursiveFill(pos, map[pos.y][pos.x], ++lastFiller);
-        return fill(pos, lastFiller++);
+        for (std::size_t x = 0; x < std::size(row); ++x)
+        {
+            auto plant = current[x];
+            auto label = noLabel;
+            if (previous[x] == plant && previousLabels[x] != noLabel)
+                label = find(previousLabels[x]);
+            if (x > 0 && current[x - 1] == plant)
+                label = label == noLabel ? find(currentLabels[x - 1])
+                                         : unite(label, currentLabels[x - 1]);
+            if (label == noLabel)
+                label = makeLabel();
+            currentLabels[x] = label;
+            metrics[label].square += 1;
+
+            if (x == 0 || current[x - 1] != plant)
+                metrics[label].perimeter += 1;
+            if (x + 1 == std::size(row) || current[x + 1] != plant)
+                metrics[label].perimeter += 1;
+        }
+        addSeam();
+        if (keepFirstRow && std::empty(firstRow))
+            firstRow = currentLabels;
+        compact(currentLabels);
+        std::swap(previous, current);
+        std::swap(previousLabels, currentLabels);
     }
 
-    Metrics recursiveFill(const position::Position& pos, char ch, int filler)
+    /**
+     * Closes the bottom edge of the band, against the row below it or the
+     * edge of the map when there is none.
+     */
+    Band finish(std::optional<std::string_view> below = std::nullopt)
     {
-        namespace rng = ::ranges;
-        namespace rv = ::ranges::views;
-        if (!inBounds(map, pos) || map[pos.y][pos.x] != ch)
-            return Metrics{.c = ch, .square = 0, .perimeter = 1};
-
-        if (visited(pos, filler))
-            return Metrics{.c = ch, .square = 0, .perimeter = 0};
-        markVisited(pos, filler);
-
-        auto result = rng::accumulate(  //
-            position::directions | rv::transform(std::bind_front(std::plus{}, pos)),
-            Metrics{.c = map[pos.y][pos.x], .square = 1, .perimeter = 0},
-            [this, ch, filler](Metrics metrics, const auto& currentPos)
-            {
-                auto neighbourMetrics = recursiveFill(currentPos, ch, filler);
-                return Metrics{
-                    .c = ch,
-                    .square = neighbourMetrics.square + metrics.square,
-                    .perimeter = neighbourMetrics.perimeter + metrics.perimeter  //
-                };
-            });
-        return result;
+        if (below)
+            current.assign(*below);
+        else
+            current.assign(std::size(previous), outside);
+        currentLabels.assign(std::size(previous), noLabel);
+        addSeam();
+        if (below)
+            compact(previousLabels);
+        else
+            compact({});
+
+        Band band{.closed = closed, .open = metrics, .firstRow = firstRow, .lastRow = {}};
+        if (below)
+            band.lastRow = previousLabels;
+        return band;
     }
 
-    Metrics fill(const position::Position& pos, int filler)
+private:
+    static constexpr char outside = '\0';
+
+    /**
+     * Horizontal edges and corners on the boundary between `previous` and
+     * `current`: every vertex of the seam is the centre of a 2x2 window.
+     */
+    void addSeam()
     {
-        namespace rng = ::ranges;
-        namespace rv = ::ranges::views;
-        std::vector<position::Position> steps{pos};
-        Metrics metrics{.c = map[pos.y][pos.x], .square = 1};
-        markVisited(pos, filler);
-        while (!std::empty(steps))
+        auto width = std::size(current);
+        for (std::size_t x = 0; x < width; ++x)
         {
-            auto currentPos = steps.back();
-            steps.pop_back();
+            if (previous[x] != current[x])
+            {
+                addTo(previousLabels[x], &Metrics::perimeter, 1);
+                addTo(currentLabels[x], &Metrics::perimeter, 1);
+            }
+        }
 
-            for (const auto& direction : position::directions)
+        for (std::size_t vertex = 0; vertex <= width; ++vertex)
+        {
+            auto plant = [vertex, width](const std::string& row, std::size_t dx)
             {
-                auto neighbour = currentPos + direction;
-                if (!inBounds(map, neighbour))
-                {
-                    metrics.perimeter += 1;
-                    continue;
-                }
-                if (visited(neighbour, filler))
-                    continue;
+                auto x = vertex + dx;  // dx == 0: left of vertex, dx == 1: right
+                return x >= 1 && x <= width ? row[x - 1] : outside;
+            };
+            auto label = [vertex, width](const std::vector<Label>& labels, std::size_t dx)
+            {
+                auto x = vertex + dx;
+                return x >= 1 && x <= width ? labels[x - 1] : noLabel;
+            };
+
+            std::array window{plant(previous, 0), plant(previous, 1), plant(current, 0),
+                              plant(current, 1)};
+            std::array labels{label(previousLabels, 0), label(previousLabels, 1),
+                              label(currentLabels, 0), label(currentLabels, 1)};
+            // window is [0 1 / 2 3]: orthogonal neighbours and the diagonal of each cell
+            constexpr std::array<std::array<std::size_t, 3>, 4> around{
+                {{1, 2, 3}, {0, 3, 2}, {0, 3, 1}, {1, 2, 0}}};
+            for (std::size_t cell = 0; cell < 4; ++cell)
+            {
+                auto self = window[cell];
+                auto [first, second, diagonal] = around[cell];
+                bool convex = window[first] != self && window[second] != self;
+                bool concave = window[first] == self && window[second] == self
+                               && window[diagonal] != self;
+                if (convex || concave)
+                    addTo(labels[cell], &Metrics::sides, 1);
+            }
+        }
+    }
 
-                if (map[neighbour.y][neighbour.x]
-                    != map[currentPos.y][currentPos.x])
-                    metrics.perimeter += 1;
-                else
-                {
-                    markVisited(neighbour, filler);
-                    metrics.square += 1;
-                    steps.push_back(neighbour);
-                }
+    /**
+     * Renumbers the regions of `openRow` and of the kept first row densely
+     * from 0, rewriting those rows to the new labels, and prices every other
+     * region: none of its cells are left to be joined or to gain an edge.
+     */
+    void compact(std::span<Label> openRow)
+    {
+        remap.assign(std::size(parents), noLabel);
+        auto keep = [this](Label& label)
+        {
+            auto root = find(label);
+            if (remap[root] == noLabel)
+            {
+                remap[root] = static_cast<Label>(std::size(kept));
+                kept.push_back(metrics[root]);
             }
+            label = remap[root];
+        };
+        for (auto& label : firstRow)
+            keep(label);
+        for (auto& label : openRow)
+            keep(label);
+
+        for (Label label = 0; label < std::size(parents); ++label)
+        {
+            if (parents[label] == label && remap[label] == noLabel)
+                closed += metrics[label];
         }
-        return metrics;
+        std::swap(metrics, kept);
+        kept.clear();
+        parents.resize(std::size(metrics));
+        std::iota(std::begin(parents), std::end(parents), Label{0});
+    }
+
+    void addTo(Label label, std::uint64_t Metrics::*counter, std::uint64_t value)
+    {
+        if (label != noLabel)
+            metrics[find(label)].*counter += value;
+    }
+
+    Label makeLabel()
+    {
+        auto label = static_cast<Label>(std::size(parents));
+        parents.push_back(label);
+        metrics.emplace_back();
+        return label;
+    }
+
+    Label find(Label label)
+    {
+        while (parents[label] != label)
+        {
+            parents[label] = parents[parents[label]];
+            label = parents[label];
+        }
+        return label;
+    }
+
+    Label unite(Label lhs, Label rhs)
+    {
+        lhs = find(lhs);
+        rhs = find(rhs);
+        if (lhs == rhs)
+            return lhs;
+        if (lhs > rhs)
+            std::swap(lhs, rhs);
+        parents[rhs] = lhs;
+        metrics[lhs] += metrics[rhs];
+        return lhs;
+    }
+
+    std::string previous;
+    std::string current;
+    std::vector<Label> previousLabels;
+    std::vector<Label> currentLabels;
+    std::vector<Label> firstRow;
+    bool keepFirstRow = false;
+    std::vector<Label> parents;
+    std::vector<Metrics> metrics;
+    Prices closed;
+    // compaction scratch
+    std::vector<Label> remap;
+    std::vector<Metrics> kept;
+};
+
+Prices measureRegions(const Map& input)
+{
+    RegionLabeller labeller;
+    for (const auto& row : input)
+        labeller.addRow(row);
+    return labeller.finish().closed;
+}
+
+/**
+ * Union-find that can be shared between threads: roots are only ever linked
+ * below a smaller root, with a compare-and-swap that fails if the root has
+ * been linked elsewhere meanwhile, so no cycles or lost merges are possible.
+ */
+class ConcurrentUnionFind
+{
+public:
+    using Label = RegionLabeller::Label;
+
+    explicit ConcurrentUnionFind(std::size_t size)
+        : parents(size)
+    {
+        for (Label label = 0; label < size; ++label)
+            parents[label].store(label, std::memory_order_relaxed);
     }
-    constexpr bool visited(const position::Position& pos, int filler) const
+
+    Label find(Label label)
     {
-        return seen[pos.y][pos.x] == filler;
+        for (;;)
+        {
+            auto parent = parents[label].load(std::memory_order_acquire);
+            if (parent == label)
+                return label;
+            auto grandparent = parents[parent].load(std::memory_order_acquire);
+            // path halving; losing the race only means less compression
+            parents[label].compare_exchange_weak(parent, grandparent, std::memory_order_release);
+            label = grandparent;
+        }
     }
 
-    bool markVisited(const position::Position& pos, int filler)
+    void unite(Label lhs, Label rhs)
     {
-        return seen[pos.y][pos.x] = filler;
+        for (;;)
+        {
+            lhs = find(lhs);
+            rhs = find(rhs);
+            if (lhs == rhs)
+                return;
+            if (lhs > rhs)
+                std::swap(lhs, rhs);
+            auto expected = rhs;
+            if (parents[rhs].compare_exchange_strong(expected, lhs, std::memory_order_acq_rel))
+                return;
+        }
     }
 
-    const Map& map;
-    int lastFiller = 0;
-    std::vector<std::vector<int>> seen;
-    static constexpr int unseen = -1;
+private:
+    std::vector<std::atomic<Label>> parents;
 };
 
+/**
+ * measureRegions split into horizontal bands of `bandHeight` rows (tiles
+ * spanning the whole width, so each is still labelled row by row). Bands are
+ * labelled independently on a thread pool, regions left open on band borders
+ * are merged with a concurrent union-find, and their metrics are then reduced
+ * per merged region.
+ */
+Prices measureRegionsParallel(const Map& input, std::size_t bandHeight = 256)
+{
+    using Label = RegionLabeller::Label;
+    if (std::empty(input))
+        return {};
+
+    auto bandCount = (std::size(input) + bandHeight - 1) / bandHeight;
+    std::vector<RegionLabeller::Band> bands(bandCount);
+    util::parallel::forEachIndex(  //
+        bandCount,
+        [&](std::size_t band, std::size_t)
+        {
+            auto first = band * bandHeight;
+            auto last = std::min(first + bandHeight, std::size(input));
+            RegionLabeller labeller;
+            if (first > 0)
+                labeller.addContext(input[first - 1]);
+            for (auto y = first; y < last; ++y)
+                labeller.addRow(input[y]);
+            bands[band] = labeller.finish(last < std::size(input)
+                                              ? std::optional<std::string_view>{input[last]}
+                                              : std::nullopt);
+        });
+
+    std::vector<Label> offsets(bandCount + 1);
+    for (std::size_t band = 0; band < bandCount; ++band)
+        offsets[band + 1] = offsets[band] + static_cast<Label>(std::size(bands[band].open));
+
+    ConcurrentUnionFind regions{offsets.back()};
+    util::parallel::forEachIndex(  //
+        bandCount - 1,
+        [&](std::size_t border, std::size_t)
+        {
+            const auto& above = bands[border];
+            const auto& below = bands[border + 1];
+            const auto& abovePlants = input[(border + 1) * bandHeight - 1];
+            const auto& belowPlants = input[(border + 1) * bandHeight];
+            for (std::size_t x = 0; x < std::size(belowPlants); ++x)
+            {
+                if (abovePlants[x] == belowPlants[x])
+                {
+                    regions.unite(offsets[border] + above.lastRow[x],
+                                  offsets[border + 1] + below.firstRow[x]);
+                }
+            }
+        });
+
+    Prices result;
+    std::vector<Metrics> merged(offsets.back());
+    std::vector<bool> isRoot(offsets.back(), false);
+    for (std::size_t band = 0; band < bandCount; ++band)
+    {
+        result += bands[band].closed;
+        for (Label region = 0; region < std::size(bands[band].open); ++region)
+        {
+            auto root = regions.find(offsets[band] + region);
+            merged[root] += bands[band].open[region];
+            isRoot[root] = true;
+        }
+    }
+
+    for (Label label = 0; label < offsets.back(); ++label)
+    {
+        if (isRoot[label])
+            result += merged[label];
+    }
+    return result;
+}
+
 namespace part1
 {
 
 std::uint64_t solve(const Map& input)
 {
-    using namespace ::ranges;
-    return accumulate(  //
-        position::all(std::ssize(input), std::ssize(input[0]))
-            | views::transform(
-                [fill = Filler{input}](const auto& pos) mutable -> Metrics
-                {
-                    return fill(pos).value_or(Metrics{});
-                }),
-        std::uint64_t{0},
-        std::plus<>{},
-        value);
+    return measureRegions(input).perimeter;
 }
 
 
@@ -173,6 +476,8 @@ void test()
         auto solution = solve(map);
         fmt::print("Part I Test1: {}\n", solution);
         assert(solution == 1930);
+        for (std::size_t bandHeight : {1, 2, 3, 256})
+            assert(measureRegionsParallel(map, bandHeight).perimeter == solution);
     }
 }
 
@@ -181,6 +486,7 @@ void solution()
     auto solution = solve(input());
     fmt::print("Part I: {}\n", solution);  // 1424472
     assert(solution == 1424472);
+    assert(measureRegionsParallel(input(), 7).perimeter == solution);
 }
 }  // namespace part1
 
@@ -189,80 +495,7 @@ namespace part2
 
 std::uint64_t solve(const Map& input)
 {
-    namespace rng = ::ranges;
-    namespace rv = ::ranges::views;
-
-    Filler fill{input};
-
-    // ignore the result - will reuse previous solution, particularly feel
-    std::vector<std::uint64_t> squares;
-    for (const auto& pos : position::all(std::ssize(input), std::ssize(input[0])))
-    {
-        if (auto result = fill(pos))
-            squares.push_back(result->square);
-    }
-
-
-    // select all boundary cells and their directions
-    const auto& seen = fill.seen;
-
-    using ByDirection = std::vector<position::Position>;
-    std::vector<std::vector<ByDirection>> boundaryCells(  //
-        fill.lastFiller + 1,
-        std::vector<ByDirection>{position::directions.size()});
-
-    for (const auto& pos : position::all(std::ssize(input), std::ssize(input[0])))
-    {
-        for (const auto& [index, direction] : position::directions | rv::enumerate)
-        {
-            auto neighbour = pos + direction;
-            if (!inBounds(input, neighbour)
-                || seen[pos.y][pos.x] != seen[neighbour.y][neighbour.x])
-                boundaryCells[seen[pos.y][pos.x]][index].push_back(pos);
-        }
-    }
-
-    std::uint64_t result = 0;
-    for (const auto& [square, byDirection] : rv::zip(squares, boundaryCells))
-    {
-        using namespace position;
-        byDirection[toIndex(DirectionIndex::Up)] |= rng::actions::sort(lessByY);
-        byDirection[toIndex(DirectionIndex::Down)] |= rng::actions::sort(lessByY);
-        byDirection[toIndex(DirectionIndex::Left)] |= rng::actions::sort(lessByX);
-        byDirection[toIndex(DirectionIndex::Right)] |= rng::actions::sort(lessByX);
-
-        auto onLineY = [](const auto& left, const auto& right)
-        {
-            return (left.x + 1) == right.x && left.y == right.y;
-        };
-        auto onLineX = [](const auto& left, const auto& right)
-        {
-            return (left.y + 1) == right.y && left.x == right.x;
-        };
-        auto one = util::functional::constant(std::uint64_t{1});
-        auto res = rng::accumulate(  //
-            byDirection[toIndex(DirectionIndex::Up)] | rv::chunk_by(onLineY),
-            0,
-            std::plus{},
-            one);
-        res += rng::accumulate(  //
-            byDirection[toIndex(DirectionIndex::Down)] | rv::chunk_by(onLineY),
-            0,
-            std::plus{},
-            one);
-        res += rng::accumulate(
-            byDirection[toIndex(DirectionIndex::Left)] | rv::chunk_by(onLineX),
-            0,
-            std::plus{},
-            one);
-        res += rng::accumulate(  //
-            byDirection[toIndex(DirectionIndex::Right)] | rv::chunk_by(onLineX),
-            0,
-            std::plus{},
-            one);
-        result += res * square;
-    }
-    return result;
+    return measureRegions(input).sides;
 }
 
 
@@ -284,6 +517,8 @@ void test()
         auto solution = solve(map);
         fmt::print("Part II Test1: {}\n", solution);
         assert(solution == 1206);
+        for (std::size_t bandHeight : {1, 2, 3, 256})
+            assert(measureRegionsParallel(map, bandHeight).sides == solution);
     }
 }
 
@@ -292,11 +527,40 @@ void solution()
     auto solution = solve(input());
     fmt::print("Part II: {}\n", solution);  // 870202
     assert(solution == 870202);
+    assert(measureRegionsParallel(input(), 7).sides == solution);
 }
 }  // namespace part2
+
+/**
+ * Sequential vs banded labelling on a large generated garden.
+ */
+void benchmark()
+{
+    constexpr std::size_t size = 4096;
+    Map map(size, std::string(size, 'A'));
+    util::Lcg random{42};
+    for (auto& row : map)
+    {
+        for (auto& plant : row)
+            plant = static_cast<char>('A' + (random() >> 62));
+    }
+
+    auto sequential = util::withTimer("measureRegions 4096x4096",
+                                      [&]
+                                      {
+                                          return measureRegions(map).sides;
+                                      });
+    auto parallel = util::withTimer("measureRegionsParallel 4096x4096",
+                                    [&]
+                                    {
+                                        return measureRegionsParallel(map).sides;
+                                    });
+    fmt::print("Benchmark: {} {}\n", sequential, parallel);
+    assert(sequential == parallel);
+}
 }  // namespace aoc2024::day12
 
-int main()
+int main(int argc, char** argv)
 {
     using namespace aoc2024;
     using namespace aoc2024::day12;
@@ -304,5 +568,7 @@ int main()
     util::withTimer("part1::solution", part1::solution);
     part2::test();
     util::withTimer("part2::solution", part2::solution);
+    if (util::benchmarkRequested(argc, argv))
+        benchmark();
     return 0;
 }
\ No newline at end of file
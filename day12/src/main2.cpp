@@ -28,7 +28,7 @@ struct Filler
 {
     Filler(const Map& input)
         : map{input}
-        , seen{std::size(input), std::vector<int>(std::ssize(input), unseen)}
+        , seen{std::size(input), std::vector<int>(std::ssize(input[0]), unseen)}
     {}
 
     void operator()(const position::Position& pos)
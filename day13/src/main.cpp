@@ -1,91 +1,236 @@
 #include "input.h"
 
-#include "util/functional.h"
-
-#include <range/v3/all.hpp>
+#include "util/util.h"
 
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
-#include <cstdlib>
-#include <string>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <optional>
 #include <string_view>
-#include <regex>
+#include <tuple>
+#include <vector>
 
 namespace aoc2024::day13
 {
 //
 
-struct Input
+/**
+ * Claw machines as a structure of arrays: one column per coefficient, so the
+ * solver streams through contiguous int64 values.
+ */
+struct Machines
 {
-    using Point = std::pair<std::int64_t, std::int64_t>;
-    Point A;
-    Point B;
-    Point prize;
+    std::size_t size() const { return std::size(prizeY); }
+
+    std::vector<std::int64_t> ax;
+    std::vector<std::int64_t> ay;
+    std::vector<std::int64_t> bx;
+    std::vector<std::int64_t> by;
+    std::vector<std::int64_t> prizeX;
+    std::vector<std::int64_t> prizeY;
 };
 
-auto format_as(const Input& input)
+auto format_as(const Machines& machines)
 {
-    return std::tie(input.A, input.B, input.prize);
+    return std::tie(machines.ax,
+                    machines.ay,
+                    machines.bx,
+                    machines.by,
+                    machines.prizeX,
+                    machines.prizeY);
 }
 
-std::vector<Input> parse(std::string_view input)
+/**
+ * Every machine is exactly six integers in a fixed order (A x/y, B x/y,
+ * prize x/y), so the parser just scans for numbers and deals them out to
+ * the columns in turn.
+ */
+Machines parse(std::string_view input)
 {
-    using namespace ::ranges;
-    std::regex patternAB{R"(Button [AB]: X\+(\d+), Y\+(\d+))"};
-    std::regex patternPrize{R"(Prize: X=(\d+), Y=(\d+))"};
-    auto parsePoint = [](std::string_view line, std::regex pattern) -> Input::Point
+    Machines machines;
+    std::array columns{&machines.ax,
+                       &machines.ay,
+                       &machines.bx,
+                       &machines.by,
+                       &machines.prizeX,
+                       &machines.prizeY};
+    auto isDigit = [](char ch)
+    {
+        return ch >= '0' && ch <= '9';
+    };
+
+    std::size_t column = 0;
+    for (std::size_t i = 0; i < std::size(input);)
     {
-        std::match_results<std::string_view::const_iterator> match;
-        if (std::regex_search(line.begin(), line.end(), match, pattern))
+        if (!isDigit(input[i]))
         {
-            auto x = std::stoll(std::string(match[1].first, match[1].second));
-            auto y = std::stoll(std::string(match[2].first, match[2].second));
-            return {x, y};
+            ++i;
+            continue;
         }
-        std::unreachable();
-    };
-    return input | views::split('\n')
-           | views::transform(
-               [](auto&& line_range)
-               {
-                   return std::string_view(&*line_range.begin(), distance(line_range));
-               })
-           | views::filter(std::not_fn(&std::string_view::empty)) | views::chunk(3)
-           | views::transform(
-               [&](auto chunk)
-               {
-                   auto it = std::begin(chunk);
-                   return Input{
-                       .A = parsePoint(std::string_view{*(it++)}, patternAB),
-                       .B = parsePoint(std::string_view{*(it++)}, patternAB),
-                       .prize = parsePoint(std::string_view{*(it++)}, patternPrize),
-                   };
-               })
-           | to<std::vector>;
+        bool negative = i > 0 && input[i - 1] == '-';
+        std::int64_t value = 0;
+        for (; i < std::size(input) && isDigit(input[i]); ++i)
+            value = value * 10 + (input[i] - '0');
+        columns[column]->push_back(negative ? -value : value);
+        column = (column + 1) % std::size(columns);
+    }
+    util::verify("every machine has six coefficients", column == 0);
+    return machines;
 }
 
-std::int64_t solveOne(const Input& input)
+__extension__ using Wide = __int128;
+
+/**
+ * Token price of a press of each button.
+ */
+struct Costs
+{
+    std::int64_t a = 3;
+    std::int64_t b = 1;
+};
+
+/**
+ * Cheapest non-negative solution of a * u + b * v == w, if there is one and
+ * the cost is bounded from below.
+ * With g = gcd(u, v) and one solution (a0, b0) from extended Euclid, all
+ * integer solutions are a = a0 + k * v / g, b = b0 - k * u / g. The
+ * non-negativity constraints bound k to an interval and the cost is linear
+ * in k, so the minimum is at one of the interval ends: O(1), no search.
+ * The particular solution scales with w, so with part II's offset it only
+ * fits in 128 bits; k itself stays within the range of w.
+ */
+std::optional<std::int64_t> solveLine(std::int64_t u,
+                                      std::int64_t v,
+                                      std::int64_t w,
+                                      const Costs& costs)
 {
-    const auto& [a, b, prize] = input;
-    auto div = a.first * b.second - a.second * b.first;
-    if (div == 0)
-        return 0;
+    if (u == 0 && v == 0)
+        return w == 0 ? std::optional<std::int64_t>{0} : std::nullopt;
 
-    auto [Anum, r1] = std::lldiv(prize.first * b.second - prize.second * b.first, div);
-    if (r1 != 0)
-        return 0;
-    auto [Bnum, r2] = std::lldiv(prize.first - Anum * a.first, b.first);
-    if (r2 != 0)
-        return 0;
+    auto [g, x, y] = util::extendedGcd(u, v);
+    if (w % g != 0)
+        return std::nullopt;
+    auto a0 = Wide{x} * (w / g);
+    auto b0 = Wide{y} * (w / g);
+    auto stepA = Wide{v / g};
+    auto stepB = Wide{-u / g};
 
-    return Anum * 3 + Bnum;
+    constexpr Wide unbounded = std::numeric_limits<std::int64_t>::max();
+    Wide low = -unbounded;
+    Wide high = unbounded;
+    // value + k * step >= 0
+    auto constrain = [&](Wide value, Wide step)
+    {
+        if (step > 0)
+            low = std::max(low, util::ceilDiv(-value, step));
+        else if (step < 0)
+            high = std::min(high, util::floorDiv(value, -step));
+        else if (value < 0)
+            high = low - 1;
+    };
+    constrain(a0, stepA);
+    constrain(b0, stepB);
+    if (low > high)
+        return std::nullopt;
+
+    // the cost falls towards the end the slope points away from; if that end
+    // is open there is no cheapest solution (only possible with negative costs)
+    auto slope = costs.a * stepA + costs.b * stepB;
+    Wide k = 0;
+    if (slope > 0)
+        k = low;
+    else if (slope < 0)
+        k = high;
+    else if (low != -unbounded || high != unbounded)
+        k = low != -unbounded ? low : high;
+    if (k == unbounded || k == -unbounded)
+        return std::nullopt;
+    return static_cast<std::int64_t>(costs.a * (a0 + k * stepA) + costs.b * (b0 + k * stepB));
 }
 
+/**
+ * A machine whose buttons move along the same line (zero determinant).
+ * The prize has to lie on that line too, and then one axis along which the
+ * line is not constant carries the whole problem.
+ */
+std::optional<std::int64_t> solveCollinear(std::int64_t ax,
+                                           std::int64_t ay,
+                                           std::int64_t bx,
+                                           std::int64_t by,
+                                           std::int64_t prizeX,
+                                           std::int64_t prizeY,
+                                           const Costs& costs)
+{
+    auto onLine = [&](std::int64_t x, std::int64_t y)
+    {
+        return Wide{x} * prizeY - Wide{y} * prizeX == 0;
+    };
+    if (!onLine(ax, ay) || !onLine(bx, by))
+        return std::nullopt;
+    if (ax == 0 && bx == 0)
+        return prizeX == 0 ? solveLine(ay, by, prizeY, costs) : std::nullopt;
+    if (ay == 0 && by == 0 && prizeY != 0)
+        return std::nullopt;
+    return solveLine(ax, bx, prizeX, costs);
+}
 
-std::uint64_t solveAll(std::span<Input> inputs)
+/**
+ * Tokens needed to win every machine whose prize is reachable, with prizes
+ * moved by `offset` on both axes. Each machine is the 2x2 system
+ * A * a + B * b = prize solved with Cramer's rule; all products are taken in
+ * 128 bits, so large offsets cannot overflow, and the exactness and sign
+ * checks are folded into a select instead of early returns so the loop body
+ * is branch-free. Machines with collinear buttons have no unique solution
+ * and are handled separately by solveCollinear. Costs may be negative, so
+ * the total is signed; a machine whose cost has no lower bound adds nothing.
+ */
+std::int64_t solveAll(const Machines& machines,
+                       std::int64_t offset = 0,
+                       const Costs& costs = {})
 {
-    return ranges::accumulate(inputs, std::uint64_t{0}, std::plus{}, solveOne);
+    std::int64_t tokens = 0;
+    std::size_t collinear = 0;
+    for (std::size_t i = 0; i < machines.size(); ++i)
+    {
+        Wide ax = machines.ax[i];
+        Wide ay = machines.ay[i];
+        Wide bx = machines.bx[i];
+        Wide by = machines.by[i];
+        Wide prizeX = Wide{machines.prizeX[i]} + offset;
+        Wide prizeY = Wide{machines.prizeY[i]} + offset;
+
+        auto det = ax * by - ay * bx;
+        auto numeratorA = prizeX * by - prizeY * bx;
+        auto numeratorB = ax * prizeY - ay * prizeX;
+        auto divisor = det == 0 ? Wide{1} : det;
+        auto a = numeratorA / divisor;
+        auto b = numeratorB / divisor;
+        bool solvable = det != 0 && a * divisor == numeratorA && b * divisor == numeratorB
+                        && a >= 0 && b >= 0;
+        tokens += solvable ? static_cast<std::int64_t>(costs.a * a + costs.b * b) : 0;
+        collinear += det == 0;
+    }
+
+    for (std::size_t i = 0; collinear > 0 && i < machines.size(); ++i)
+    {
+        if (Wide{machines.ax[i]} * machines.by[i] != Wide{machines.ay[i]} * machines.bx[i])
+            continue;
+        --collinear;
+        tokens += solveCollinear(machines.ax[i],
+                                 machines.ay[i],
+                                 machines.bx[i],
+                                 machines.by[i],
+                                 machines.prizeX[i] + offset,
+                                 machines.prizeY[i] + offset,
+                                 costs)
+                      .value_or(0);
+    }
+    return tokens;
 }
 
 namespace part1
@@ -97,6 +242,35 @@ void test()
     auto solution = solveAll(input);
     fmt::print("{}\n", input);
     fmt::print("Part I Test: {}\n", solution);  // 480
+    assert(solution == 480);
+    // 80 + 40 and 38 + 86 presses, each earning a token
+    assert(solveAll(input, 0, {.a = -1, .b = -1}) == -244);
+
+    // collinear buttons: the old solver gave up on these
+    auto collinear = parse(R"(Button A: X+2, Y+4
+Button B: X+3, Y+6
+Prize: X=12, Y=24
+
+Button A: X+4, Y+2
+Button B: X+2, Y+1
+Prize: X=10, Y=5
+
+Button A: X+2, Y+2
+Button B: X+4, Y+4
+Prize: X=3, Y=3
+
+Button A: X+1, Y+2
+Button B: X+2, Y+4
+Prize: X=4, Y=9
+)");
+    // 4 * B, 5 * B, parity mismatch, off the line
+    assert(solveAll(collinear) == 4 + 5);
+
+    // a == b for any a >= 0: cheapest at a == 0, unless presses earn tokens
+    assert(solveLine(1, -1, 0, Costs{.a = 1, .b = 1}) == 0);
+    assert(!solveLine(1, -1, 0, Costs{.a = -1, .b = -1}));
+    // with A cheaper than B, 6 * A and 2 * A + B win instead
+    assert(solveAll(collinear, 0, {.a = 1, .b = 3}) == 6 + 5);
 }
 
 void solution()
@@ -105,40 +279,74 @@ void solution()
 
     auto solution = solveAll(input);
     fmt::print("Part I: {}\n", solution);  // 30973
+    assert(solution == 30973);
 }
 }  // namespace part1
 
 namespace part2
 {
+constexpr std::int64_t increment = 10'000'000'000'000;
+
+void test()
+{
+    // collinear buttons at part II scale: the particular solution overflows 64 bits
+    auto collinear = parse(R"(Button A: X+9999991, Y+9999991
+Button B: X+10000019, Y+10000019
+Prize: X=12, Y=12
+)");
+    auto solution = solveAll(collinear, increment);
+    fmt::print("Part II Test: {}\n", solution);  // 2357142
+    assert(solution == 2357142);
+}
 
 void solution()
 {
-    using namespace ::ranges;
-    constexpr auto increment = 10'000'000'000'000;
-    auto originalInput = parse(aoc2024::day13::input);
-    auto input = originalInput
-                 | views::transform(
-                     [increment](const auto& input)
-                     {
-                         return Input{.A = input.A,
-                                      .B = input.B,
-                                      .prize = {input.prize.first + increment,
-                                                input.prize.second + increment}};
-                     })
-                 | to<std::vector>;
+    auto input = parse(aoc2024::day13::input);
+    auto solution = solveAll(input, increment);
+    fmt::print("Part II: {}\n", solution);  // 95688837203288
+    assert(solution == 95688837203288);
+}
 
-    auto solution = solveAll(input);
-    fmt::print("Part II: {}\n", solution);
+/**
+ * Throughput of the batched solver on generated machines.
+ */
+void benchmark()
+{
+    constexpr std::size_t count = 1'000'000;
+    Machines machines;
+    util::Lcg random{13};
+    auto next = [&random](std::uint64_t limit)
+    {
+        return static_cast<std::int64_t>(random.below(limit)) + 1;
+    };
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        machines.ax.push_back(next(99));
+        machines.ay.push_back(next(99));
+        machines.bx.push_back(next(99));
+        machines.by.push_back(next(99));
+        machines.prizeX.push_back(next(20'000));
+        machines.prizeY.push_back(next(20'000));
+    }
+    auto solution = util::withTimer("solveAll 10^6 machines",
+                                    [&]
+                                    {
+                                        return solveAll(machines, increment);
+                                    });
+    fmt::print("Benchmark: {}\n", solution);
 }
 }  // namespace part2
 }  // namespace aoc2024::day13
 
-int main()
+int main(int argc, char** argv)
 {
     using namespace aoc2024;
     using namespace aoc2024::day13;
     part1::test();
     part1::solution();
+    part2::test();
     part2::solution();
+    if (util::benchmarkRequested(argc, argv))
+        part2::benchmark();
     return 0;
 }
\ No newline at end of file
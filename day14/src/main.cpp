@@ -1,7 +1,6 @@
 #include "input.h"
 
-#include "util/position.h"
-#include "util/functional.h"
+#include "util/util.h"
 
 #include <range/v3/all.hpp>
 
@@ -10,16 +9,24 @@
 
 #include <ctre.hpp>
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
-#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
 #include <string_view>
-#include <unordered_set>
-#include <iostream>
+#include <tuple>
+#include <vector>
 
 namespace aoc2024::day14
 {
-namespace position = aoc2024::util::position;
-
 constexpr std::string_view testInput = R"(p=0,4 v=3,-3
 p=6,3 v=-1,-3
 p=10,3 v=-1,2
@@ -33,129 +40,133 @@ p=7,3 v=-1,2
 p=2,4 v=2,-3
 p=9,5 v=-3,-3)";
 
-struct Robot
-{
-    position::Position position;
-    position::Delta velocity;
-};
+using Dimension = std::pair<int, int>;  // height, width
 
-auto format_as(const Robot& robot)
+/**
+ * Robots as a structure of arrays: positions at any time are computed from
+ * these columns in one pass, without stepping.
+ */
+struct Robots
 {
-    return std::tie(robot.position, robot.velocity);
-}
+    std::size_t size() const { return std::size(x); }
 
-using Dimension = std::pair<int, int>;
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<int> vx;
+    std::vector<int> vy;
+};
 
-void move(Robot& robot, const Dimension& dimension, int steps)
+struct Positions
 {
-    robot.position += position::Delta{robot.velocity.first * steps,
-                                      robot.velocity.second * steps};
+    std::size_t size() const { return std::size(x); }
 
-    robot.position.x = robot.position.x >= dimension.second
-                           ? robot.position.x % dimension.second
-                           : robot.position.x;
-
-    robot.position.x =
-        robot.position.x < 0
-            ? (dimension.second - (std::abs(robot.position.x) % dimension.second))
-                  % dimension.second
-            : robot.position.x;
+    std::vector<int> x;
+    std::vector<int> y;
+};
 
-    robot.position.y = robot.position.y >= dimension.first
-                           ? robot.position.y % dimension.first
-                           : robot.position.y;
-    robot.position.y =
-        robot.position.y < 0
-            ? (dimension.first - (std::abs(robot.position.y) % dimension.first))
-                  % dimension.first
-            : robot.position.y;
+Robots parse(std::string_view input)
+{
+    using namespace ::ranges;
+    Robots robots;
+    auto lines = input | views::split('\n')
+                 | views::transform(
+                     [](auto&& line_range)
+                     {
+                         return std::string_view(&*line_range.begin(), distance(line_range));
+                     })
+                 | views::filter(std::not_fn(&std::string_view::empty));
+    for (auto line : lines)
+    {
+        auto [whole, posX, posY, velX, velY] =
+            ctre::match<R"(p=(-?\d+),(-?\d+) v=(-?\d+),(-?\d+))">(line);
+        robots.x.push_back(posX.to_number());
+        robots.y.push_back(posY.to_number());
+        robots.vx.push_back(velX.to_number());
+        robots.vy.push_back(velY.to_number());
+    }
+    return robots;
 }
 
-std::vector<Robot> parse(std::string_view input)
+/**
+ * Closed form position on one axis: ((p + v * t) mod dim + dim) mod dim.
+ * Time is reduced modulo the dimension first, so everything stays in int.
+ */
+void axisAt(std::span<const int> position,
+            std::span<const int> velocity,
+            int size,
+            std::int64_t seconds,
+            std::span<int> result)
 {
-    using namespace ::ranges;
-    return input | views::split('\n')
-           | views::transform(
-               [](auto&& line_range)
-               {
-                   return std::string_view(&*line_range.begin(), distance(line_range));
-               })
-           | views::filter(std::not_fn(&std::string_view::empty))
-           | views::transform(
-               [](auto&& line)
-               {
-                   auto [whole, posX, posY, velX, velY] =
-                       ctre::match<R"(p=(-?\d+),(-?\d+) v=(-?\d+),(-?\d+))">(line);
-                   return Robot{
-                       .position = {posY.to_number(), posX.to_number()},
-                       .velocity = {velY.to_number(), velX.to_number()},
-                   };
-               })
-           | to<std::vector>;
+    auto time = static_cast<int>(seconds % size);
+    for (std::size_t i = 0; i < std::size(result); ++i)
+        result[i] = ((position[i] + velocity[i] * time) % size + size) % size;
 }
 
-void move(std::span<Robot> input, const Dimension& dim, int times)
+/**
+ * Positions of all robots after `seconds`, written into `result` so that
+ * repeated evaluations reuse the same buffers.
+ */
+void positionsAt(const Robots& robots,
+                 const Dimension& dim,
+                 std::int64_t seconds,
+                 Positions& result)
 {
-    for (auto& robot : input)
-        move(robot, dim, times);
+    result.x.resize(robots.size());
+    result.y.resize(robots.size());
+    axisAt(robots.x, robots.vx, dim.second, seconds, result.x);
+    axisAt(robots.y, robots.vy, dim.first, seconds, result.y);
 }
 
 using Map = std::vector<std::string>;
 
-Map debug(const std::vector<Robot>& input, const Dimension& dim)
+Map debug(const Positions& positions, const Dimension& dim)
 {
     Map result(dim.first, std::string(dim.second, '.'));
-    for (const auto& robot : input)
+    for (std::size_t i = 0; i < positions.size(); ++i)
     {
-        auto& res = result[robot.position.y][robot.position.x];
+        auto& res = result[positions.y[i]][positions.x[i]];
         res = res == '.' ? '1' : res + 1;
     }
     return result;
 }
 
-namespace part1
+/**
+ * Quadrant index 0..3 of a position, computed from comparisons; positions on
+ * the middle lines go to a fifth bucket (4), so callers need no branches.
+ */
+constexpr std::size_t quadrantOf(int x, int y, const Dimension& dim)
 {
-struct Square
+    auto middleY = dim.first / 2;
+    auto middleX = dim.second / 2;
+    std::size_t quadrant = (x > middleX) + 2 * (y > middleY);
+    bool onMiddle = (x == middleX) | (y == middleY);
+    return onMiddle ? 4 : quadrant;
+}
+
+namespace part1
 {
-    position::Position leftTop;
-    position::Position rightBottom;
-};
-bool belongsBetween(const Robot& robot, const Square& square)
+/**
+ * Product of robot counts per quadrant.
+ */
+std::uint64_t safetyFactor(const Positions& positions, const Dimension& dim)
 {
-    return robot.position.x >= square.leftTop.x
-           && robot.position.y >= square.leftTop.y
-           && robot.position.x < square.rightBottom.x
-           && robot.position.y < square.rightBottom.y;
+    std::array<std::uint64_t, 5> counts{};
+    for (std::size_t i = 0; i < positions.size(); ++i)
+        ++counts[quadrantOf(positions.x[i], positions.y[i], dim)];
+    return counts[0] * counts[1] * counts[2] * counts[3];
 }
 
-std::uint64_t solve(std::vector<Robot> input, const Dimension& dim, int seconds)
+std::uint64_t solve(const Robots& input, const Dimension& dim, int seconds)
 {
-    using namespace ::ranges;
-    move(input, dim, seconds);
-    // 7 11 - 3 5
-    auto squares = std::to_array({
-        Square{.leftTop = {0, 0}, .rightBottom = {dim.first / 2, dim.second / 2}},
-        Square{.leftTop = {0, dim.second / 2 + 1},
-               .rightBottom = {dim.first / 2, dim.second}},
-        Square{.leftTop = {dim.first / 2 + 1, 0},
-               .rightBottom = {dim.first, dim.second / 2}},
-        Square{.leftTop = {dim.first / 2 + 1, dim.second / 2 + 1},
-               .rightBottom = {dim.first, dim.second}}  //
-    });
-    return accumulate(squares,
-                      1,
-                      std::multiplies<>{},
-                      [&](const auto& square)
-                      {
-                          return count_if(input, bind_back(belongsBetween, square));
-                      });
+    Positions positions;
+    positionsAt(input, dim, seconds, positions);
+    return safetyFactor(positions, dim);
 }
 
 void test()
 {
-    using namespace ::ranges;
     auto input = parse(testInput);
-    fmt::print("{}\n", input | views::transform(&Robot::position));
+    fmt::print("{}\n", std::tie(input.x, input.y));
     assert(input.size() == 12);
     fmt::print("{}\n", solve(input, {7, 11}, 100));
     assert(solve(input, {7, 11}, 100) == 12);
@@ -164,63 +175,490 @@ void test()
 void solution()
 {
     auto input = parse(aoc2024::day14::input);
-    auto solution = solve(std::move(input), {103, 101}, 100);
+    auto solution = solve(input, {103, 101}, 100);
     fmt::print("Part I: {}\n", solution);
-    assert(224357412);
+    assert(solution == 224357412);
 }
 }  // namespace part1
 
 namespace part2
 {
+/**
+ * Each axis of the robot motion is periodic in its own dimension, and the
+ * picture is the moment both axes cluster at once. So find, per axis, the
+ * time within one period where positions have the least variance, then
+ * combine the two residues with the Chinese remainder theorem: width +
+ * height cheap evaluations instead of scanning up to width * height frames.
+ */
+std::int64_t clusteredAxisTime(std::span<const int> position,
+                               std::span<const int> velocity,
+                               int size)
+{
+    std::vector<int> axis(std::size(position));
+    auto count = static_cast<std::int64_t>(std::size(position));
+    std::int64_t bestTime = 0;
+    auto bestSpread = std::numeric_limits<std::int64_t>::max();
+    for (std::int64_t time = 0; time < size; ++time)
+    {
+        axisAt(position, velocity, size, time, axis);
+        std::int64_t sum = 0;
+        std::int64_t squares = 0;
+        for (auto value : axis)
+        {
+            sum += value;
+            squares += value * value;
+        }
+        // variance scaled by count^2, exact in integers
+        auto spread = count * squares - sum * sum;
+        if (spread < bestSpread)
+        {
+            bestSpread = spread;
+            bestTime = time;
+        }
+    }
+    return bestTime;
+}
+
+std::optional<std::int64_t> solve(const Robots& input, const Dimension& dim)
+{
+    auto timeX = clusteredAxisTime(input.x, input.vx, dim.second);
+    auto timeY = clusteredAxisTime(input.y, input.vy, dim.first);
+    auto combined = util::chineseRemainder<std::int64_t>(timeX, dim.second, timeY, dim.first);
+    if (!combined)
+        return std::nullopt;
+    return combined->first;
+}
+
 void solution()
 {
-    using namespace ::ranges;
     auto input = parse(aoc2024::day14::input);
     Dimension dim{103, 101};
-    std::string current;
-    std::unordered_set<std::string> seen;
 
-    auto accumulate = [](const auto& range, auto group)
+    // Christmas tree appears every 10403 seconds
+    auto solution = solve(input, dim);
+    util::verify("the axis periods combine into a frame", solution.has_value());
+    assert(solution == 7083);
+    fmt::print("Part II: {}\n", *solution);
+
+    Positions positions;
+    positionsAt(input, dim, *solution, positions);
+    fmt::print("{}\n", fmt::join(debug(positions, dim), "\n"));
+}
+}  // namespace part2
+
+namespace stream
+{
+/**
+ * Per-frame summary of the robot picture, stored verbatim in frame files:
+ * - entropy: Shannon entropy (bits) of the robot distribution over cells;
+ * - quadrantBalance: fewest / most robots in a quadrant, 1 when even;
+ * - largestCluster: cells in the largest 4-connected group of occupied cells;
+ * - occupiedCells: cells holding at least one robot.
+ */
+struct FrameMetrics
+{
+    float entropy;
+    float quadrantBalance;
+    std::uint32_t largestCluster;
+    std::uint32_t occupiedCells;
+};
+
+/**
+ * Steps robots one second at a time and keeps an occupancy grid up to date
+ * from each robot's move instead of rebuilding frames: per-cell counts, an
+ * occupancy bitmap and the sum of c * log2(c) over cell counts c, from which
+ * the entropy follows in O(1). Quadrant counts are a vectorised pass over the
+ * positions and the cluster walk works on bitmaps small enough to stay in L1.
+ *
+ * Cells are laid out in rows of whole 64-bit words with at least one unused
+ * column at the end, so a row's bits shift by a column without masking and
+ * stepping one cell left or right never reaches into another row's cells.
+ */
+class Simulation
+{
+public:
+    Simulation(const Robots& robots, const Dimension& dim)
+        : dim(dim)
+        , x(robots.x)
+        , y(robots.y)
+        , words(static_cast<std::size_t>(dim.second) / 64 + 1)
+        , counts(cellCount(), 0)
+        , occupancy(cellCount() / 64, 0)
+        , gains(robots.size() + 1, 0.0)
+        , linked(std::size(occupancy), 0)
+        , pending(robots.size() + 1, 0)
+    {
+        // velocities in [0, size), so a step wraps with a single subtraction
+        for (std::size_t i = 0; i < robots.size(); ++i)
+        {
+            vx.push_back((robots.vx[i] % width() + width()) % width());
+            vy.push_back((robots.vy[i] % height() + height()) % height());
+        }
+        auto weight = [](double count)
+        {
+            return count == 0 ? 0.0 : count * std::log2(count);
+        };
+        for (std::size_t count = 0; count < std::size(gains); ++count)
+            gains[count] = weight(count + 1.0) - weight(count);
+        for (std::size_t i = 0; i < std::size(x); ++i)
+            weightSum += add(cellOf(x[i], y[i]));
+    }
+
+    void step()
     {
-        auto one = util::functional::constant(std::uint64_t{1});
-        return ::ranges::accumulate(range | views::chunk_by(group), 0, std::plus{}, one);
-    };
-    // 22090 - a loop found using hashes - no point to look further
-    // using histogram found one example  17485: 161, 174
+        // separate sums keep the loop free of a single long dependency chain
+        double gained = 0;
+        double lost = 0;
+        for (std::size_t i = 0; i < std::size(x); ++i)
+        {
+            lost += remove(cellOf(x[i], y[i]));
+            x[i] += vx[i];
+            x[i] -= (x[i] >= width()) * width();
+            y[i] += vy[i];
+            y[i] -= (y[i] >= height()) * height();
+            gained += add(cellOf(x[i], y[i]));
+        }
+        weightSum += gained - lost;
+        ++now;
+    }
 
-    // Christmas tree appears every 10403 seconds
-    // 7082: 234, 238
-
-    // 17485: 234, 238
-    // 27888: 234, 238
-    // 38291: 234, 238
-    // 48694: 234, 238
-    // 59097: 234, 238
-    for (std::size_t i = 1;; ++i)
-    {
-        move(input, dim, 1);
-
-        auto x = input | views::transform(&Robot::position) | to_vector;
-        auto y = input | views::transform(&Robot::position) | to_vector;
-        x |= actions::sort(position::lessByX);
-        y |= actions::sort(position::lessByY);
-        auto countX = accumulate(x, position::followedByX);
-        auto countY = accumulate(y, position::followedByY);
-        if (countX < 420 || countY < 420)
+    FrameMetrics metrics()
+    {
+        auto robots = static_cast<double>(std::size(x));
+        auto quadrants = quadrantCounts();
+        auto [fewest, most] = std::ranges::minmax(quadrants);
+        std::uint32_t occupied = 0;
+        for (auto word : occupancy)
+            occupied += std::popcount(word);
+        return {
+            static_cast<float>(std::log2(robots) - weightSum / robots),
+            most == 0 ? 1.0f : static_cast<float>(fewest) / static_cast<float>(most),
+            largestCluster(),
+            occupied,
+        };
+    }
+
+    std::int64_t time() const { return now; }
+    const Dimension& dimension() const { return dim; }
+    std::size_t robots() const { return std::size(x); }
+
+    /** Occupancy rows of rowWords() words each, bit x of a row for column x. */
+    std::span<const std::uint64_t> occupancyBits() const { return occupancy; }
+    std::size_t rowWords() const { return words; }
+
+private:
+    int width() const { return dim.second; }
+    int height() const { return dim.first; }
+    std::size_t stride() const { return words * 64; }
+    std::size_t cellCount() const { return stride() * height(); }
+    std::size_t cellOf(int px, int py) const { return py * stride() + px; }
+
+    /** Returns the change of the c * log2(c) sum. */
+    double add(std::size_t cell)
+    {
+        auto count = counts[cell]++;
+        occupancy[cell / 64] |= std::uint64_t{1} << (cell % 64);
+        return gains[count];
+    }
+
+    double remove(std::size_t cell)
+    {
+        auto count = --counts[cell];
+        occupancy[cell / 64] &= ~(std::uint64_t{count == 0} << (cell % 64));
+        return gains[count];
+    }
+
+    std::array<std::uint32_t, 4> quadrantCounts() const
+    {
+        std::array<std::uint32_t, 4> result{};
+        auto middleY = height() / 2;
+        auto middleX = width() / 2;
+        for (std::size_t i = 0; i < std::size(x); ++i)
         {
-            fmt::print("{}: {}, {}\n", i, countY, countX);
-            fmt::print("{}\n", fmt::join(debug(input, dim), "\n"));
-            break;
+            bool left = x[i] < middleX;
+            bool right = x[i] > middleX;
+            bool top = y[i] < middleY;
+            bool bottom = y[i] > middleY;
+            result[0] += left & top;
+            result[1] += right & top;
+            result[2] += left & bottom;
+            result[3] += right & bottom;
         }
+        return result;
     }
+
+    /**
+     * Most occupied cells are isolated, so the walk starts only from cells
+     * with an occupied neighbour, found a row of words at a time.
+     */
+    std::uint32_t largestCluster()
+    {
+        std::uint32_t largest = 0;
+        for (std::size_t row = 0; row < static_cast<std::size_t>(height()); ++row)
+        {
+            const auto* above = row > 0 ? &occupancy[(row - 1) * words] : nullptr;
+            const auto* current = &occupancy[row * words];
+            const auto* below = row + 1 < static_cast<std::size_t>(height())
+                                    ? &occupancy[(row + 1) * words]
+                                    : nullptr;
+            for (std::size_t word = 0; word < words; ++word)
+            {
+                auto bits = current[word];
+                auto left = bits << 1 | (word > 0 ? current[word - 1] >> 63 : 0);
+                auto right = bits >> 1 | (word + 1 < words ? current[word + 1] << 63 : 0);
+                auto vertical = (above ? above[word] : 0) | (below ? below[word] : 0);
+                linked[row * words + word] = bits & (left | right | vertical);
+                largest |= bits != 0;
+            }
+        }
+
+        std::size_t top = 0;
+        // unconditional push, conditional advance: a neighbour test is close to
+        // a coin flip, too costly as a branch; taking the bit marks it visited
+        auto visit = [&](std::size_t cell)
+        {
+            auto bit = std::uint64_t{1} << (cell % 64);
+            bool fresh = (linked[cell / 64] & bit) != 0;
+            linked[cell / 64] &= ~bit;
+            pending[top] = static_cast<std::uint32_t>(cell);
+            top += fresh;
+        };
+        for (std::size_t word = 0; word < std::size(linked); ++word)
+        {
+            while (linked[word] != 0)
+            {
+                visit(word * 64 + std::countr_zero(linked[word]));
+                std::uint32_t size = 0;
+                while (top > 0)
+                {
+                    std::size_t cell = pending[--top];
+                    ++size;
+                    // past the grid edges the cell itself is visited again, already taken
+                    visit(cell + 1);
+                    visit(cell > 0 ? cell - 1 : cell);
+                    visit(cell + stride() < cellCount() ? cell + stride() : cell);
+                    visit(cell >= stride() ? cell - stride() : cell);
+                }
+                largest = std::max(largest, size);
+            }
+        }
+        return largest;
+    }
+
+    Dimension dim;
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<int> vx;
+    std::vector<int> vy;
+    std::int64_t now = 0;
+    std::size_t words;  // per row
+
+    std::vector<std::uint16_t> counts;
+    std::vector<std::uint64_t> occupancy;
+    std::vector<double> gains;  // (c + 1) * log2(c + 1) - c * log2(c)
+    double weightSum = 0;
+
+    std::vector<std::uint64_t> linked;
+    std::vector<std::uint32_t> pending;
+};
+
+/**
+ * Frame file layout (host byte order): a FileHeader, then fixed-size records
+ * of {int64 time, FrameMetrics, occupancy bitmap}, so frame i can be read
+ * back with a single seek. The bitmap has `height` rows of `rowWords` words,
+ * bit x of a row set when column x is occupied.
+ */
+struct FileHeader
+{
+    std::array<char, 8> magic;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t robots;
+    std::uint32_t rowWords;
+};
+
+constexpr std::array<char, 8> frameMagic{'A', 'O', 'C', '1', '4', 'F', 'R', 'M'};
+
+struct Frame
+{
+    std::int64_t time;
+    FrameMetrics metrics;
+    std::vector<std::uint64_t> occupancy;
+};
+
+class FrameWriter
+{
+public:
+    FrameWriter(const std::filesystem::path& path, const Simulation& simulation)
+        : out(path, std::ios::binary)
+    {
+        util::verify("frame file opened", out.good());
+        const auto& dim = simulation.dimension();
+        FileHeader header{frameMagic,
+                          static_cast<std::uint32_t>(dim.second),
+                          static_cast<std::uint32_t>(dim.first),
+                          static_cast<std::uint32_t>(simulation.robots()),
+                          static_cast<std::uint32_t>(simulation.rowWords())};
+        writeRaw(header);
+    }
+
+    void write(const Simulation& simulation, const FrameMetrics& metrics)
+    {
+        auto bits = simulation.occupancyBits();
+        writeRaw(simulation.time());
+        writeRaw(metrics);
+        out.write(reinterpret_cast<const char*>(std::data(bits)),
+                  static_cast<std::streamsize>(bits.size_bytes()));
+        util::verify("frame written", out.good());
+    }
+
+    /**
+     * Flushes and closes the file; a full disk may only surface here.
+     */
+    void close()
+    {
+        out.close();
+        util::verify("frame file closed", !out.fail());
+    }
+
+private:
+    void writeRaw(const auto& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    std::ofstream out;
+};
+
+class FrameReader
+{
+public:
+    explicit FrameReader(const std::filesystem::path& path)
+        : in(path, std::ios::binary)
+    {
+        readRaw(header);
+        util::verify("frame file header", in.good() && header.magic == frameMagic);
+    }
+
+    const FileHeader& fileHeader() const { return header; }
+
+    std::size_t bitmapWords() const
+    {
+        return static_cast<std::size_t>(header.height) * header.rowWords;
+    }
+
+    std::size_t recordSize() const
+    {
+        return sizeof(std::int64_t) + sizeof(FrameMetrics) + bitmapWords() * sizeof(std::uint64_t);
+    }
+
+    Frame read(std::size_t index)
+    {
+        Frame frame{0, {}, std::vector<std::uint64_t>(bitmapWords())};
+        in.seekg(static_cast<std::streamoff>(sizeof(FileHeader) + index * recordSize()));
+        readRaw(frame.time);
+        readRaw(frame.metrics);
+        in.read(reinterpret_cast<char*>(std::data(frame.occupancy)),
+                static_cast<std::streamsize>(bitmapWords() * sizeof(std::uint64_t)));
+        util::verify("frame read", in.good());
+        return frame;
+    }
+
+private:
+    void readRaw(auto& value)
+    {
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
+    std::ifstream in;
+    FileHeader header{};
+};
+
+/**
+ * Streams one full period of frames to path and picks the frame with the
+ * largest cluster, then reads it back from the file.
+ */
+void solution(const std::filesystem::path& path)
+{
+    auto input = parse(aoc2024::day14::input);
+    Dimension dim{103, 101};
+    Simulation simulation(input, dim);
+
+    std::int64_t bestTime = 0;
+    std::uint32_t bestCluster = 0;
+    {
+        FrameWriter writer(path, simulation);
+        for (std::int64_t frame = 0; frame < dim.first * dim.second; ++frame)
+        {
+            auto metrics = simulation.metrics();
+            writer.write(simulation, metrics);
+            if (metrics.largestCluster > bestCluster)
+            {
+                bestCluster = metrics.largestCluster;
+                bestTime = simulation.time();
+            }
+            simulation.step();
+        }
+        writer.close();
+    }
+    fmt::print("Stream: largest cluster of {} cells at {}\n", bestCluster, bestTime);
+    assert(bestTime == 7083);
+
+    FrameReader reader(path);
+    auto frame = reader.read(bestTime);
+    Positions positions;
+    positionsAt(input, dim, bestTime, positions);
+    bool matches = frame.time == bestTime && frame.metrics.largestCluster == bestCluster;
+    for (std::size_t i = 0; i < positions.size(); ++i)
+    {
+        auto cell = positions.y[i] * reader.fileHeader().rowWords * 64 + positions.x[i];
+        matches = matches && (frame.occupancy[cell / 64] >> (cell % 64) & 1);
+    }
+    util::verify("frame read back matches closed form positions", matches);
 }
-}  // namespace part2
+
+void benchmark()
+{
+    constexpr std::int64_t frames = 100'000;
+    auto input = parse(aoc2024::day14::input);
+    Simulation simulation(input, {103, 101});
+    auto largest = util::withTimer("step + metrics for 10^5 frames",
+                                   [&]
+                                   {
+                                       std::uint32_t result = 0;
+                                       for (std::int64_t frame = 0; frame < frames; ++frame)
+                                       {
+                                           result = std::max(result,
+                                                             simulation.metrics().largestCluster);
+                                           simulation.step();
+                                       }
+                                       return result;
+                                   });
+    fmt::print("Benchmark: largest cluster {}\n", largest);
+}
+}  // namespace stream
 }  //   namespace aoc2024::day14
-int main()
+int main(int argc, char** argv)
 {
     using namespace aoc2024::day14;
     part1::test();
     part1::solution();
     part2::solution();
+
+    // --stream <path> writes every frame of one period (~17 MB) to path
+    auto args = std::span(argv, argc);
+    auto flag = std::ranges::find_if(args,
+                                     [](std::string_view arg)
+                                     {
+                                         return arg == "--stream";
+                                     });
+    if (flag != std::end(args) && std::next(flag) != std::end(args))
+    {
+        stream::solution(*std::next(flag));
+    }
+    if (aoc2024::util::benchmarkRequested(argc, argv))
+    {
+        stream::benchmark();
+    }
     return 0;
 }
\ No newline at end of file
@@ -1,17 +1,19 @@
 #include "input.h"
-#include "util/map.h"
-#include "util/position.h"
+#include "util/util.h"
 
 #include <range/v3/all.hpp>
 
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
-#include <vector>
+#include <cstdint>
+#include <string>
 #include <string_view>
-#include <unordered_set>
-#include <list>
+#include <utility>
+#include <vector>
 
 namespace aoc2024::day15
 {
@@ -77,76 +79,244 @@ Input testInput()
     };
 }
 
-std::uint64_t posToValue(const position::Position& pos)
-{
-    return 100 * pos.y + pos.x;
-}
-
-namespace part1
+/**
+ * Contents of a warehouse cell. Part II boxes span two cells, a BoxLeft
+ * always directly followed by a BoxRight.
+ */
+enum class Cell : std::uint8_t
 {
+    Empty,
+    Wall,
+    Box,
+    BoxLeft,
+    BoxRight,
+};
 
+/**
+ * The warehouse as one flat grid of cell types with the robot kept aside.
+ * Pushes work in place on the grid: a row push shifts the run of box cells
+ * ahead of the robot by one, a column push collects the boxes it moves with a
+ * reusable stack and epoch-stamped visits, so a move costs O(boxes pushed)
+ * and allocates nothing once the buffers have grown.
+ */
 struct WorldState
 {
+    /**
+     * Consecutive identical moves, executed together.
+     */
+    struct MoveRun
+    {
+        position::DirectionDescription move;
+        std::size_t count;
+    };
+
+    /**
+     * Executes the next run of moves: the robot walks through empty cells in
+     * one scan and pushes one step at a time. Once a move is blocked nothing
+     * changes until the robot moves again, so the rest of the run, and any
+     * run in a direction already blocked since, is skipped in O(1).
+     */
     bool moveRobot()
     {
-        auto direction = moves[currentStep++];
-        auto next = robot + direction;
+        auto [move, remaining] = runs[currentStep++];
+        auto [directionIndex, direction] = move;
+        auto directionBit = 1u << position::toIndex(directionIndex);
+        if ((blocked & directionBit) != 0)
+            return currentStep < runs.size();
+
+        auto step = static_cast<std::ptrdiff_t>(direction.first) * width + direction.second;
+        bool horizontal = directionIndex == position::DirectionIndex::Left
+                          || directionIndex == position::DirectionIndex::Right;
+        while (remaining > 0)
+        {
+            auto next = robot + step;
+            for (; remaining > 0 && cells[next] == Cell::Empty; --remaining, next += step)
+            {
+                robot = next;
+                blocked = 0;
+            }
+            if (remaining == 0)
+                break;
 
-        auto boxPos = next;
-        while (map.inBounds(boxPos) && boxes.contains(boxPos) && map.value(boxPos) != '#')
-            boxPos += direction;
+            bool free = cells[next] != Cell::Wall
+                        && (horizontal ? pushRow(next, step) : pushColumn(next, step));
+            if (!free)
+            {
+                blocked |= directionBit;
+                break;
+            }
+            robot = next;
+            blocked = 0;
+            --remaining;
+        }
+        return currentStep < runs.size();
+    }
 
-        if (map.inBounds(boxPos) && map.value(boxPos) != '#' && next != boxPos)
+    /**
+     * Shifts the run of box cells starting at `first` by one `step`, if it
+     * ends in an empty cell.
+     */
+    bool pushRow(std::size_t first, std::ptrdiff_t step)
+    {
+        auto last = first;
+        while (isBox(cells[last]))
+            last += step;
+        if (cells[last] == Cell::Wall)
+            return false;
+        for (; last != first; last -= step)
+            cells[last] = cells[last - step];
+        cells[first] = Cell::Empty;
+        return true;
+    }
+
+    /**
+     * Moves every box resting on the box at `first` by one `step`, if none of
+     * them is blocked by a wall.
+     */
+    bool pushColumn(std::size_t first, std::ptrdiff_t step)
+    {
+        if (++epoch == 0)
         {
-            boxes.erase(next);
-            boxes.insert(boxPos);
+            std::ranges::fill(visited, 0);
+            epoch = 1;
+        }
+        pushed.clear();
+        pending.clear();
+        pending.push_back(first);
+        while (!std::empty(pending))
+        {
+            auto cell = pending.back();
+            pending.pop_back();
+            switch (cells[cell])
+            {
+            case Cell::Wall:
+                return false;
+            case Cell::Empty:
+                continue;
+            case Cell::BoxRight:
+                --cell;
+                break;
+            default:
+                break;
+            }
+            if (visited[cell] == epoch)
+                continue;
+            visited[cell] = epoch;
+            pushed.push_back({cell, cells[cell]});
+            pending.push_back(cell + step);
+            if (cells[cell] == Cell::BoxLeft)
+                pending.push_back(cell + 1 + step);
         }
 
-        if (map.inBounds(next) && map.value(next) != '#' && !boxes.contains(next))
-            robot = next;
-        return currentStep < moves.size();
+        // lift all boxes first, so none overwrites another that is moving
+        for (auto [cell, box] : pushed)
+        {
+            cells[cell] = Cell::Empty;
+            cells[cell + (box == Cell::BoxLeft)] = Cell::Empty;
+        }
+        for (auto [cell, box] : pushed)
+        {
+            cells[cell + step] = box;
+            if (box == Cell::BoxLeft)
+                cells[cell + 1 + step] = Cell::BoxRight;
+        }
+        return true;
     }
 
-    position::Position robot{};
-    std::unordered_set<position::Position> boxes{};
-    position::Map map;
-    std::vector<position::Direction> moves;
-    std::size_t currentStep = 0;
-};
+    static constexpr bool isBox(Cell cell)
+    {
+        return cell == Cell::Box || cell == Cell::BoxLeft || cell == Cell::BoxRight;
+    }
 
-std::uint64_t solve(WorldState state)
-{
-    using namespace ::ranges;
-    while (state.moveRobot())
-        ;
+    void debug() const
+    {
+        constexpr std::array symbols{'.', '#', 'O', '[', ']'};
+        position::MapData mapData(std::size(cells) / width);
+        for (std::size_t cell = 0; cell < std::size(cells); ++cell)
+        {
+            auto symbol = cell == robot ? '@' : symbols[std::to_underlying(cells[cell])];
+            mapData[cell / width].push_back(symbol);
+        }
+        fmt::print("Map {}: \n{}\n", currentStep, fmt::join(mapData, "\n"));
+    }
 
-    return accumulate(state.boxes, std::uint64_t{0}, std::plus{}, posToValue);
-}
+    std::vector<Cell> cells;
+    std::size_t width = 0;
+    std::size_t robot = 0;
+    std::vector<MoveRun> runs;
+    std::size_t currentStep = 0;
+    unsigned blocked = 0;  // bit per DirectionIndex, moves known to fail
 
-WorldState initialize(Input input)
+    std::vector<std::uint32_t> visited;
+    std::uint32_t epoch = 0;
+    std::vector<std::size_t> pending;
+    std::vector<std::pair<std::size_t, Cell>> pushed;  // leftmost cell of each box
+};
+
+/**
+ * Builds the state from map rows with '@' for the robot, 'O', '[' or ']' for
+ * boxes and '#' for walls. The pushes rely on the walls enclosing the map.
+ */
+WorldState initialize(const position::MapData& data, std::string_view moves)
 {
     using namespace ::ranges;
-    WorldState result{.map = position::Map{std::move(input.data)}};
-    for (const auto& pos : result.map.all())
+    WorldState result;
+    result.width = std::size(data[0]);
+    for (const auto& row : data)
     {
-        auto& val = result.map.value(pos);
-        if (val == '@')
-        {
-            result.robot = pos;
-            val = '.';
-        }
-        else if (result.map.value(pos) == 'O')
+        util::verify("rows of equal width", std::size(row) == result.width);
+        for (auto val : row)
         {
-            result.boxes.insert(pos);
-            val = '.';
+            if (val == '@')
+                result.robot = std::size(result.cells);
+            result.cells.push_back(val == '#'   ? Cell::Wall
+                                   : val == 'O' ? Cell::Box
+                                   : val == '[' ? Cell::BoxLeft
+                                   : val == ']' ? Cell::BoxRight
+                                                : Cell::Empty);
         }
     }
+    auto enclosed = all_of(data.front(), std::bind_front(std::equal_to{}, '#'))
+                    && all_of(data.back(), std::bind_front(std::equal_to{}, '#'))
+                    && all_of(data,
+                              [](const std::string& row)
+                              {
+                                  return row.front() == '#' && row.back() == '#';
+                              });
+    util::verify("map enclosed in walls", enclosed);
+    result.visited.assign(std::size(result.cells), 0);
+
+    for (auto move : moves | views::transform(position::fromChar))
+    {
+        if (!std::empty(result.runs) && result.runs.back().move.first == move.first)
+            ++result.runs.back().count;
+        else
+            result.runs.push_back({move, 1});
+    }
+    return result;
+}
 
-    for (auto [_, move] : input.moves | ranges::views::transform(position::fromChar))
-        result.moves.push_back(move);
+std::uint64_t solve(WorldState state)
+{
+    while (state.moveRobot())
+        ;
+
+    std::uint64_t result = 0;
+    for (std::size_t cell = 0; cell < std::size(state.cells); ++cell)
+    {
+        if (state.cells[cell] == Cell::Box || state.cells[cell] == Cell::BoxLeft)
+            result += 100 * (cell / state.width) + cell % state.width;
+    }
     return result;
 }
 
+namespace part1
+{
+WorldState initialize(const Input& input)
+{
+    return day15::initialize(input.data, input.moves);
+}
+
 void test()
 {
     {
@@ -171,185 +341,39 @@ void solution()
 
 namespace part2
 {
-struct Box
-{
-    position::Position position;
-    position::Direction next;
-};
-
-struct WorldState
-{
-    bool moveRobot()
-    {
-        auto [directionIndex, direction] = moves[currentStep++];
-        auto next = robot + direction;
-
-        if (!map.inBounds(next) || map.value(next) == '#')
-            return currentStep < moves.size();
-
-        if (map.value(next) == '.' && !boxes.contains(next))  // move robot
-        {
-            robot = next;
-            return currentStep < moves.size();
-        }
-
-        auto [canMove, boxesToMove] = [&] -> std::pair<bool, std::vector<Box>>
-        {
-            if (directionIndex == position::DirectionIndex::Left
-                || directionIndex == position::DirectionIndex::Right)
-            {
-                std::vector<Box> result;
-
-                auto boxPos = next;
-                while (map.inBounds(boxPos) && boxes.contains(boxPos))
-                {
-                    result.push_back(boxes[boxPos]);
-                    boxPos += direction;
-                }
-
-                return map.inBounds(boxPos) && map.value(boxPos) != '#'
-                           ? std::pair{true, std::move(result)}
-                           : std::pair{false, std::vector<Box>{}};
-            }
-            else  // up or down
-            {
-                std::vector<Box> result;
-                std::list<position::Position> toProcess{next};
-                std::unordered_set<position::Position> visited;
-                while (!std::empty(toProcess))
-                {
-                    auto pos = toProcess.front();
-                    toProcess.pop_front();
-
-                    if (visited.contains(pos))
-                        continue;
-
-                    if (!boxes.contains(pos))
-                        continue;
-                    auto& box = boxes[pos];
-
-                    result.push_back(box);
-                    visited.insert(pos);
-
-                    // 2nd part of the box
-                    toProcess.push_back(pos + box.next);
-
-                    // move upper/bottom boxes
-                    auto movePos = pos + direction;
-                    if (!map.inBounds(movePos) || map.value(movePos) == '#')
-                        return std::pair{false, std::vector<Box>{}};
-
-                    if (boxes.contains(movePos))
-                        toProcess.push_back(movePos);
-                }
-                return std::pair{true, std::move(result)};
-            }
-        }();
-
-        if (canMove)
-        {
-            // move boxes
-            std::vector<std::unordered_map<position::Position, Box>::node_type> extractedNodes;
-            for (auto& box : boxesToMove)
-                extractedNodes.push_back(boxes.extract(box.position));
-
-            for (auto& node : extractedNodes)
-            {
-                node.key() += direction;
-                node.mapped().position += direction;
-                boxes.insert(std::move(node));
-            }
-            robot = next;
-        }
-        return currentStep < moves.size();
-    }
-
-    void debug()
-    {
-        auto mapData = map.data;
-        for (const auto& [pos, box] : boxes)
-            mapData[pos.y][pos.x] = box.next == position::left ? ']' : '[';
-        mapData[robot.y][robot.x] = '@';
-        fmt::print("Map {}: \n{}\n", currentStep, fmt::join(mapData, "\n"));
-    }
-
-    position::Position robot{};
-    std::unordered_map<position::Position, Box> boxes;
-    position::Map map;
-    std::vector<position::DirectionDescription> moves;
-    std::size_t currentStep = 0;
-};
-
-WorldState initialize(const Input& inp)
+/**
+ * Everything but the robot is twice as wide.
+ */
+WorldState initialize(const Input& input)
 {
-    using namespace ::ranges;
-    position::MapData data{std::size(inp.data)};
-    position::Position robot;
-    std::unordered_map<position::Position, Box> boxes;
-    std::vector<position::DirectionDescription> moves;
-    for (const auto& [j, row] : inp.data | views::enumerate)
+    position::MapData data;
+    for (const auto& row : input.data)
     {
-        for (const auto& [i, val] : row | views::enumerate)
+        auto& wide = data.emplace_back();
+        for (auto val : row)
         {
-            auto pos =
-                position::Position{static_cast<int>(j), 2 * static_cast<int>(i)};
-
-            char toWrite = [&]
-            {
-                if (val == 'O')
-                {
-                    boxes.insert({pos, Box{pos, position::right}});
-                    auto other = pos + position::right;
-                    boxes.insert({other, Box{other, position::left}});
-                }
-                if (val == '#')
-                    return '#';
-                else if (val == '@')
-                    robot = pos;
-
-                return '.';
-            }();
-
-            data[j].push_back(toWrite);
-            data[j].push_back(toWrite);
+            wide += val == '#'   ? "##"
+                    : val == 'O' ? "[]"
+                    : val == '@' ? "@."
+                                 : "..";
         }
     }
-
-    for (auto move : inp.moves | ranges::views::transform(position::fromChar))
-        moves.push_back(move);
-    return {.robot = robot,
-            .boxes = std::move(boxes),
-            .map = std::move(data),
-            .moves = std::move(moves)};
-}
-
-std::uint64_t solve(WorldState world)
-{
-    using namespace ::ranges;
-    while (world.moveRobot())
-        ;
-
-    return accumulate(world.boxes | views::values
-                          | views::filter(std::bind_front(std::equal_to{}, position::right),
-                                          &Box::next)
-                          | views::transform(&Box::position),
-                      std::uint64_t{0},
-                      std::plus{},
-                      posToValue);
+    return day15::initialize(data, input.moves);
 }
 
 void test()
 {
     {
         auto solution = solve(initialize(testInput()));
-        fmt::print("Part I Test 2: {}\n", solution);
+        fmt::print("Part II Test 2: {}\n", solution);
+        assert(solution == 9021);
     }
 }
 
 void solution()
 {
     auto solution = solve(initialize(input()));
-    fmt::print("Part I: {}\n", solution);
+    fmt::print("Part II: {}\n", solution);
     assert(solution == 1521635);
 }
 
@@ -1,134 +1,614 @@
 #include "input.h"
 
-#include "util/position.h"
-#include "util/map.h"
+#include "util/util.h"
 
 #include <range/v3/all.hpp>
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
-#include <deque>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <span>
+#include <string>
 #include <unordered_set>
-#include <mdspan>
+#include <utility>
+#include <vector>
 
 namespace aoc2024::day16
 {
 namespace position = aoc2024::util::position;
+/**
+ * Reindeer maze as a flat grid. Search states are (cell, facing) pairs,
+ * numbered cell * 4 + facing, so distance fields are flat arrays.
+ */
 struct Maze
 {
+    using Cost = std::uint32_t;
+    using State = std::uint32_t;
+    static constexpr Cost unreachable = std::numeric_limits<Cost>::max();
+    static constexpr Cost stepCost = 1;
+    static constexpr Cost turnCost = 1000;
+
     Maze(position::MapData data)
         : map{std::move(data)}
+        , width(map.width())
     {
-        for (const auto& pos : map.all())
+        for (int y = 0; y < map.height(); ++y)
         {
-            auto& val = map.value(pos);
-            if (val == 'S')
+            for (int x = 0; x < map.width(); ++x)
             {
-                start = pos;
-                val = '.';
+                auto& val = map.value({y, x});
+                if (val == 'S')
+                {
+                    start = {y, x};
+                    val = '.';
+                }
+                else if (val == 'E')
+                {
+                    end = {y, x};
+                    val = '.';
+                }
+                open.push_back(val != '#');
             }
-            else if (val == 'E')
+        }
+        // moves need no bounds checks inside the outer wall
+        bool walled = true;
+        for (int x = 0; x < map.width(); ++x)
+            walled = walled && !open[cellOf({0, x})] && !open[cellOf({map.height() - 1, x})];
+        for (int y = 0; y < map.height(); ++y)
+            walled = walled && !open[cellOf({y, 0})] && !open[cellOf({y, map.width() - 1})];
+        util::verify("maze enclosed in walls", walled);
+    }
+
+    std::size_t cellOf(const position::Position& pos) const
+    {
+        return static_cast<std::size_t>(pos.y) * width + pos.x;
+    }
+
+    static State stateOf(std::size_t cell, position::DirectionIndex facing)
+    {
+        return static_cast<State>(cell * 4 + position::toIndex(facing));
+    }
+
+    std::ptrdiff_t offset(position::DirectionIndex facing) const
+    {
+        auto [dy, dx] = position::directions[position::toIndex(facing)];
+        return static_cast<std::ptrdiff_t>(dy) * width + dx;
+    }
+
+    /**
+     * A move goes one cell ahead, either keeping the facing or after a turn
+     * left or right; `edge(next, cost)` is called for every open target.
+     */
+    void forEachMove(State state, auto&& edge) const
+    {
+        std::size_t cell = state / 4;
+        auto facing = static_cast<position::DirectionIndex>(state % 4);
+        for (auto [next, cost] : {
+                 std::pair{facing, stepCost},
+                 std::pair{position::turnRight(facing), turnCost + stepCost},
+                 std::pair{position::turnLeft(facing), turnCost + stepCost},
+             })
+        {
+            auto target = cell + offset(next);
+            if (open[target])
+                edge(stateOf(target, next), cost);
+        }
+    }
+
+    /**
+     * Moves backwards: all states whose move ends in `state`.
+     */
+    void forEachReverseMove(State state, auto&& edge) const
+    {
+        auto facing = static_cast<position::DirectionIndex>(state % 4);
+        auto source = state / 4 - offset(facing);
+        if (!open[source])
+            return;
+        edge(stateOf(source, facing), stepCost);
+        edge(stateOf(source, position::turnLeft(facing)), turnCost + stepCost);
+        edge(stateOf(source, position::turnRight(facing)), turnCost + stepCost);
+    }
+
+    /**
+     * Dijkstra from `sources` with a bucket queue (Dial's algorithm): edge
+     * costs are at most turnCost + stepCost, so a ring of that many + 1
+     * buckets indexed by cost holds every pending state and a bucket never
+     * receives states while it is being drained.
+     */
+    std::vector<Cost> distances(std::span<const State> sources, auto&& forEachEdge) const
+    {
+        std::vector<Cost> result(std::size(open) * 4, unreachable);
+        std::vector<std::vector<State>> buckets(turnCost + stepCost + 1);
+        std::size_t pending = 0;
+        for (auto source : sources)
+        {
+            result[source] = 0;
+            buckets[0].push_back(source);
+            ++pending;
+        }
+        for (Cost cost = 0; pending > 0; ++cost)
+        {
+            auto& bucket = buckets[cost % std::size(buckets)];
+            for (auto state : bucket)
             {
-                end = pos;
-                val = '.';
+                if (result[state] != cost)
+                    continue;  // reached cheaper after it was queued
+                forEachEdge(state,
+                            [&](State next, Cost edge)
+                            {
+                                auto nextCost = cost + edge;
+                                if (nextCost < result[next])
+                                {
+                                    result[next] = nextCost;
+                                    buckets[nextCost % std::size(buckets)].push_back(next);
+                                    ++pending;
+                                }
+                            });
             }
+            pending -= std::size(bucket);
+            bucket.clear();
         }
+        return result;
     }
 
-    static constexpr std::size_t maxSize = 1000;
-
-    constexpr bool canMove(const position::Position& pos) const
+    /**
+     * Cost of the cheapest path from start to end and the number of tiles on
+     * any cheapest path. A tile is on one when, for some facing, the cost
+     * from the start plus the cost to the end (reverse search seeded with
+     * every end facing) equals the best cost: no parents are tracked.
+     */
+    std::pair<std::size_t, std::size_t> searchWithTracking() const
     {
-        return map.inBounds(pos) && map.value(pos) != '#';
+        std::array source{stateOf(cellOf(start), startDirection)};
+        auto forward = distances(source,
+                                 [this](State state, auto&& edge)
+                                 {
+                                     forEachMove(state, edge);
+                                 });
+
+        std::array<State, 4> targets{};
+        Cost best = unreachable;
+        for (std::size_t facing = 0; facing < 4; ++facing)
+        {
+            targets[facing] = static_cast<State>(cellOf(end) * 4 + facing);
+            best = std::min(best, forward[targets[facing]]);
+        }
+        if (best == unreachable)
+            return {};
+
+        auto backward = distances(targets,
+                                  [this](State state, auto&& edge)
+                                  {
+                                      forEachReverseMove(state, edge);
+                                  });
+        std::size_t tiles = 0;
+        for (std::size_t cell = 0; cell < std::size(open); ++cell)
+        {
+            bool onBestPath = false;
+            for (std::size_t state = cell * 4; state < cell * 4 + 4; ++state)
+            {
+                onBestPath = onBestPath
+                             || std::uint64_t{forward[state]} + backward[state] == best;
+            }
+            tiles += onBestPath;
+        }
+        return {best, tiles};
     }
 
-    // feels like backtracking is ugly
-    std::pair<std::size_t, std::size_t> searchWithTracking()
+    position::Position start;
+    position::DirectionIndex startDirection = position::DirectionIndex::Right;
+    position::Position end;
+    position::Map map;
+    std::size_t width;
+    std::vector<std::uint8_t> open;
+};
+
+constexpr position::DirectionIndex turnAround(position::DirectionIndex direction)
+{
+    return position::turnRight(position::turnRight(direction));
+}
+
+/**
+ * The maze contracted to its junctions, the open cells without exactly two
+ * open neighbours (dead ends included). Every corridor between two of them
+ * becomes an edge per direction carrying its cost, corner turns included, and
+ * the number of tiles inside it. The graph does not depend on the start or
+ * end: a query attaches cells lying inside corridors by walking to the
+ * corridor ends, so one graph serves any number of queries on the maze.
+ */
+class JunctionGraph
+{
+public:
+    using Cost = Maze::Cost;
+    using Index = std::uint32_t;
+    static constexpr Index none = std::numeric_limits<Index>::max();
+
+    struct Corridor
     {
-        using namespace ::ranges;
-        struct HeapElement
+        Index target = none;  // none: the exit is a wall
+        position::DirectionIndex arrival{};
+        Cost cost = 0;
+        std::uint32_t tiles = 0;  // cells strictly between the junctions
+    };
+
+    /**
+     * Where a walk along a corridor ends: at a junction, the `stop` cell or,
+     * for a corridor closing on itself, the cell it started from.
+     */
+    struct Walk
+    {
+        std::size_t end;
+        position::DirectionIndex arrival;
+        Cost cost;
+    };
+
+    explicit JunctionGraph(const Maze& maze)
+        : width(maze.width)
+        , open(maze.open)
+        , junctionOf(std::size(open), none)
+    {
+        for (std::size_t cell = 0; cell < std::size(open); ++cell)
         {
-            std::size_t cost = 0;
-            position::Position pos;
-            position::DirectionIndex direction;
-        };
+            if (open[cell] && exits(cell) != 2)
+            {
+                junctionOf[cell] = static_cast<Index>(std::size(cells));
+                cells.push_back(cell);
+            }
+        }
+        corridors.resize(std::size(cells) * 4);
+        incoming.resize(std::size(cells) * 4, none);
+        for (Index junction = 0; junction < size(); ++junction)
+        {
+            for (std::size_t exit = 0; exit < 4; ++exit)
+            {
+                auto facing = static_cast<position::DirectionIndex>(exit);
+                if (!open[cells[junction] + offset(facing)])
+                    continue;
+                std::uint32_t tiles = 0;
+                auto walk = walkFrom(cells[junction],
+                                     facing,
+                                     noCell,
+                                     [&tiles](std::size_t)
+                                     {
+                                         ++tiles;
+                                     });
+                auto target = junctionOf[walk.end];
+                corridors[junction * 4 + exit] = {target, walk.arrival, walk.cost, tiles - 1};
+                incoming[target * 4 + position::toIndex(walk.arrival)] = junction * 4 + exit;
+            }
+        }
+    }
+
+    Index size() const { return static_cast<Index>(std::size(cells)); }
 
-        std::deque<HeapElement> heap{HeapElement{0, start, startDirection}};
+    /**
+     * Same as Maze::searchWithTracking, for any start, facing and end.
+     */
+    std::pair<std::size_t, std::size_t> search(const position::Position& startPos,
+                                               position::DirectionIndex facing,
+                                               const position::Position& endPos)
+    {
+        start = cellOf(startPos);
+        end = cellOf(endPos);
+        if (start == end)
+            return {0, 1};
+        prepareQuery();
 
-        auto [height, width] = map.dim();
-        struct BacktrackingData
+        using Entry = std::pair<Cost, Index>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<>> heap;
+        auto relax = [&](Index state, Cost cost, std::uint8_t via)
         {
-            std::size_t cost = std::numeric_limits<std::size_t>::max();
-            std::unordered_set<position::Position> parents;
+            if (cost < distance[state])
+            {
+                distance[state] = cost;
+                predecessors[state] = via;
+                heap.emplace(cost, state);
+            }
+            else if (cost == distance[state])
+            {
+                predecessors[state] |= via;
+            }
         };
-        std::vector<BacktrackingData> backtrackStorage(height * width * 4);
-        auto backTrack = std::mdspan{backtrackStorage.data(), height, width, 4};
 
+        if (auto junction = junctionOf[start]; junction != none)
+            relax(junction * 4 + position::toIndex(facing), 0, 0);
+        forEachSeed(facing,
+                    [&](const Walk& walk, Cost cost, position::DirectionIndex)
+                    {
+                        relax(nodeOf(walk.end) * 4 + position::toIndex(walk.arrival),
+                              cost,
+                              fromStart);
+                    });
+
+        Cost best = Maze::unreachable;
         while (!std::empty(heap))
         {
-            auto element = heap.front();
-            pop_heap(heap, std::greater{}, &HeapElement::cost);
-            heap.pop_back();
+            auto [cost, state] = heap.top();
+            heap.pop();
+            if (cost > best)
+                break;
+            if (cost != distance[state])
+                continue;
+            Index node = state / 4;
+            if (node == endNode)
+            {
+                best = cost;
+                continue;
+            }
+            auto facingHere = static_cast<position::DirectionIndex>(state % 4);
+            for (auto [exit, turn] : {
+                     std::pair{facingHere, Cost{0}},
+                     std::pair{position::turnRight(facingHere), Maze::turnCost},
+                     std::pair{position::turnLeft(facingHere), Maze::turnCost},
+                 })
+            {
+                auto [target, arrival, corridorCost, tiles] = corridorTo(node, exit);
+                if (target != none)
+                {
+                    relax(target * 4 + position::toIndex(arrival),
+                          cost + turn + corridorCost,
+                          static_cast<std::uint8_t>(1u << position::toIndex(facingHere)));
+                }
+            }
+        }
+        if (best == Maze::unreachable)
+            return {};
+        return {best, countTiles(best, facing)};
+    }
 
-            auto& backTrackRecord = backTrack[element.pos.y,
-                                              element.pos.x,
-                                              position::toIndex(element.direction)];
-            if (element.pos == end)
-                return {element.cost, backTrackRecord.parents.size() + 1};
+private:
+    static constexpr std::size_t noCell = std::numeric_limits<std::size_t>::max();
+    static constexpr std::uint8_t fromStart = 1u << 4;  // predecessor bit of seeds
 
+    /**
+     * The part of a corridor from a junction exit to the end cell, replacing
+     * the whole corridor while the end lies inside it.
+     */
+    struct Port
+    {
+        Index junction = none;
+        position::DirectionIndex exit{};
+        position::DirectionIndex arrival{};
+        Cost cost = 0;
+    };
 
-            for (const auto& [dirIndex, dirCost] : {
-                     std::pair{element.direction, 0},
-                     std::pair{position::turnRight(element.direction), 1000},
-                     std::pair{position::turnLeft(element.direction), 1000},  //
-                 })
+    std::size_t cellOf(const position::Position& pos) const
+    {
+        return static_cast<std::size_t>(pos.y) * width + pos.x;
+    }
+
+    std::ptrdiff_t offset(position::DirectionIndex facing) const
+    {
+        auto [dy, dx] = position::directions[position::toIndex(facing)];
+        return static_cast<std::ptrdiff_t>(dy) * width + dx;
+    }
+
+    int exits(std::size_t cell) const
+    {
+        int result = 0;
+        for (std::size_t facing = 0; facing < 4; ++facing)
+            result += open[cell + offset(static_cast<position::DirectionIndex>(facing))];
+        return result;
+    }
+
+    /**
+     * Follows a corridor from `cell` leaving towards `facing`, calling
+     * `onCell` for every cell entered.
+     */
+    Walk walkFrom(std::size_t cell,
+                  position::DirectionIndex facing,
+                  std::size_t stop,
+                  auto&& onCell) const
+    {
+        auto from = cell;
+        Cost cost = 0;
+        for (;;)
+        {
+            cell += offset(facing);
+            cost += Maze::stepCost;
+            onCell(cell);
+            if (junctionOf[cell] != none || cell == stop || cell == from)
+                return {cell, facing, cost};
+            if (!open[cell + offset(facing)])
             {
-                auto nextPos = element.pos
-                               + position::directions[position::toIndex(dirIndex)];
+                auto left = position::turnLeft(facing);
+                facing = open[cell + offset(left)] ? left : position::turnRight(facing);
+                cost += Maze::turnCost;
+            }
+        }
+    }
 
-                if (!canMove(nextPos))
-                    continue;
+    Index nodeOf(std::size_t cell) const
+    {
+        return cell == end ? endNode : junctionOf[cell];
+    }
 
-                auto newCost = element.cost + dirCost + 1;
+    Corridor corridorTo(Index junction, position::DirectionIndex exit) const
+    {
+        for (const auto& port : ports)
+        {
+            if (port.junction == junction && port.exit == exit)
+                return {endNode, port.arrival, port.cost, 0};
+        }
+        return corridors[junction * 4 + position::toIndex(exit)];
+    }
 
-                if (newCost < backTrack[nextPos.y, nextPos.x, position::toIndex(dirIndex)]
-                                  .cost)
-                {
-                    std::unordered_set<position::Position> parent{element.pos};
-
-                    parent.insert(std::begin(backTrackRecord.parents),
-                                  std::end(backTrackRecord.parents));
-                    backTrack[nextPos.y, nextPos.x, position::toIndex(dirIndex)] =
-                        BacktrackingData{
-                            .cost = newCost,
-                            .parents = std::move(parent),
-                        };
-
-                    heap.emplace_back(newCost, nextPos, dirIndex);
-                    push_heap(heap, std::greater{}, &HeapElement::cost);  // not needed
-                }
-                else if (newCost
-                         == backTrack[nextPos.y, nextPos.x, position::toIndex(dirIndex)]
-                                .cost)
+    /**
+     * Per query: the end becomes an extra node when it lies in a corridor,
+     * reached through the ports at both corridor ends.
+     */
+    void prepareQuery()
+    {
+        ports.clear();
+        endNode = junctionOf[end];
+        if (endNode == none)
+        {
+            endNode = size();
+            for (std::size_t exit = 0; exit < 4; ++exit)
+            {
+                auto away = static_cast<position::DirectionIndex>(exit);
+                if (!open[end + offset(away)])
+                    continue;
+                auto walk = walkFrom(end, away, noCell, [](std::size_t) {});
+                if (junctionOf[walk.end] != none)
                 {
-                    backTrack[nextPos.y, nextPos.x, position::toIndex(dirIndex)]
-                        .parents.insert(element.pos);
-                    backTrack[nextPos.y, nextPos.x, position::toIndex(dirIndex)]
-                        .parents.insert(std::begin(backTrackRecord.parents),
-                                        std::end(backTrackRecord.parents));
+                    ports.push_back({junctionOf[walk.end],
+                                     turnAround(walk.arrival),
+                                     turnAround(away),
+                                     walk.cost});
                 }
             }
         }
+        distance.assign((size() + 1) * 4, Maze::unreachable);
+        predecessors.assign((size() + 1) * 4, 0);
+    }
+
+    /**
+     * A start inside a corridor leaves it along either exit not behind it:
+     * `seed(walk, cost, exit)` for each, walking up to a junction or the end.
+     */
+    void forEachSeed(position::DirectionIndex facing, auto&& seed) const
+    {
+        if (junctionOf[start] != none)
+            return;
+        for (auto [exit, turn] : {
+                 std::pair{facing, Cost{0}},
+                 std::pair{position::turnRight(facing), Maze::turnCost},
+                 std::pair{position::turnLeft(facing), Maze::turnCost},
+             })
+        {
+            if (!open[start + offset(exit)])
+                continue;
+            auto walk = walkFrom(start, exit, end, [](std::size_t) {});
+            if (walk.end != start)
+                seed(walk, turn + walk.cost, exit);
+        }
+    }
+
+    /**
+     * Tiles on any best path, from the recorded equal-cost predecessors:
+     * junctions and the start and end cells individually, whole corridors by
+     * their tile count (once per corridor, whichever direction is used) and
+     * the partial corridors next to the start and end cell by cell.
+     */
+    std::size_t countTiles(Cost best, position::DirectionIndex facing)
+    {
+        std::vector<Index> pending;
+        std::vector<std::uint8_t> expanded(std::size(distance), 0);
+        for (std::size_t arrival = 0; arrival < 4; ++arrival)
+        {
+            if (distance[endNode * 4 + arrival] == best)
+                pending.push_back(static_cast<Index>(endNode * 4 + arrival));
+        }
+
+        std::unordered_set<std::size_t> marked{start, end};
+        std::unordered_set<Index> fullCorridors;
+        auto mark = [&marked](std::size_t cell)
+        {
+            marked.insert(cell);
+        };
+        while (!std::empty(pending))
+        {
+            auto state = pending.back();
+            pending.pop_back();
+            if (std::exchange(expanded[state], 1) != 0)
+                continue;
+            Index node = state / 4;
+            auto arrival = static_cast<position::DirectionIndex>(state % 4);
+            if (node < size())
+                marked.insert(cells[node]);
+
+            auto via = predecessors[state];
+            if ((via & fromStart) != 0)
+            {
+                forEachSeed(facing,
+                            [&](const Walk& walk, Cost, position::DirectionIndex exit)
+                            {
+                                if (nodeOf(walk.end) == node && walk.arrival == arrival)
+                                    walkFrom(start, exit, end, mark);
+                            });
+            }
+            if ((via & ~fromStart) == 0)
+                continue;
+
+            // every corridor ends in one (node, arrival) state, a port at the end
+            Index source = 0;
+            position::DirectionIndex exit{};
+            if (node == endNode && node == size())
+            {
+                auto port = std::ranges::find(ports, arrival, &Port::arrival);
+                source = port->junction;
+                exit = port->exit;
+                walkFrom(cells[source], exit, end, mark);
+            }
+            else
+            {
+                auto edge = incoming[state];
+                source = edge / 4;
+                exit = static_cast<position::DirectionIndex>(edge % 4);
+                auto reverse = corridors[edge].target * 4
+                               + position::toIndex(turnAround(corridors[edge].arrival));
+                fullCorridors.insert(std::min(edge, static_cast<Index>(reverse)));
+            }
+            for (std::size_t from = 0; from < 4; ++from)
+            {
+                if ((via >> from & 1) != 0)
+                    pending.push_back(static_cast<Index>(source * 4 + from));
+            }
+        }
 
+        std::size_t tiles = std::size(marked);
+        for (auto edge : fullCorridors)
+        {
+            tiles += corridors[edge].tiles;
+            // the start's corridor may be both walked partly and used whole
+            if (junctionOf[start] == none && onCorridor(edge, start))
+            {
+                walkFrom(cells[edge / 4],
+                         static_cast<position::DirectionIndex>(edge % 4),
+                         noCell,
+                         [&](std::size_t cell)
+                         {
+                             tiles -= marked.contains(cell) && junctionOf[cell] == none;
+                         });
+            }
+        }
+        return tiles;
+    }
 
-        return {};
+    bool onCorridor(Index edge, std::size_t cell) const
+    {
+        bool found = false;
+        walkFrom(cells[edge / 4],
+                 static_cast<position::DirectionIndex>(edge % 4),
+                 noCell,
+                 [&](std::size_t visited)
+                 {
+                     found = found || visited == cell;
+                 });
+        return found;
     }
 
+    std::size_t width;
+    std::vector<std::uint8_t> open;
+    std::vector<Index> junctionOf;
+    std::vector<std::size_t> cells;
+    std::vector<Corridor> corridors;  // junction * 4 + exit
+    std::vector<Index> incoming;      // junction * 4 + arrival -> corridor
 
-    position::Position start;
-    position::DirectionIndex startDirection = position::DirectionIndex::Right;
-    position::Position end;
-    position::Map map;
+    // per query
+    std::size_t start = 0;
+    std::size_t end = 0;
+    Index endNode = none;
+    std::vector<Port> ports;
+    std::vector<Cost> distance;
+    std::vector<std::uint8_t> predecessors;
 };
 
 position::MapData testData1{
@@ -169,6 +649,140 @@ position::MapData testData2{
     "#S#.............#",
     "#################",
 };
+/**
+ * Many (start, facing) queries against one end. The cost to the end from
+ * every cell and facing is computed once, by the reverse search of
+ * Maze::searchWithTracking; a query reads its cost off that field and counts
+ * tiles by following only moves that keep move cost + remaining cost equal to
+ * the cost before, so it visits the states on best paths and nothing else.
+ */
+class RoutesToEnd
+{
+public:
+    using Cost = Maze::Cost;
+    using State = Maze::State;
+
+    RoutesToEnd(const Maze& maze, const position::Position& end)
+        : maze(maze)
+        , visitedState(std::size(maze.open) * 4, 0)
+        , visitedCell(std::size(maze.open), 0)
+    {
+        std::array<State, 4> targets{};
+        for (std::size_t facing = 0; facing < 4; ++facing)
+        {
+            targets[facing] =
+                Maze::stateOf(maze.cellOf(end), static_cast<position::DirectionIndex>(facing));
+        }
+        toEnd = maze.distances(targets,
+                               [&maze](State state, auto&& edge)
+                               {
+                                   maze.forEachReverseMove(state, edge);
+                               });
+    }
+
+    std::pair<std::size_t, std::size_t> query(const position::Position& start,
+                                              position::DirectionIndex facing)
+    {
+        auto first = Maze::stateOf(maze.cellOf(start), facing);
+        if (toEnd[first] == Maze::unreachable)
+            return {};
+
+        // epoch stamps: nothing to clear between queries
+        if (++epoch == 0)
+        {
+            std::ranges::fill(visitedState, 0);
+            std::ranges::fill(visitedCell, 0);
+            epoch = 1;
+        }
+        std::size_t tiles = 0;
+        pending.clear();
+        pending.push_back(first);
+        visitedState[first] = epoch;
+        while (!std::empty(pending))
+        {
+            auto state = pending.back();
+            pending.pop_back();
+            tiles += std::exchange(visitedCell[state / 4], epoch) != epoch;
+            maze.forEachMove(state,
+                             [&](State next, Cost cost)
+                             {
+                                 if (toEnd[next] != Maze::unreachable
+                                     && toEnd[next] + cost == toEnd[state]
+                                     && std::exchange(visitedState[next], epoch) != epoch)
+                                 {
+                                     pending.push_back(next);
+                                 }
+                             });
+        }
+        return {toEnd[first], tiles};
+    }
+
+private:
+    const Maze& maze;
+    std::vector<Cost> toEnd;
+    std::vector<std::uint32_t> visitedState;
+    std::vector<std::uint32_t> visitedCell;
+    std::uint32_t epoch = 0;
+    std::vector<State> pending;
+};
+
+/**
+ * A puzzle-like maze of `size` x `size` cells (odd): a random spanning tree
+ * of the odd cells carved depth first, which gives long corridors, with some
+ * walls between corridors knocked out for loops and ties. Start bottom left,
+ * end top right.
+ */
+position::MapData generateMaze(int size, std::uint64_t seed)
+{
+    util::Lcg random{seed};
+    auto next = [&random](std::uint64_t limit)
+    {
+        return static_cast<int>(random.below(limit));
+    };
+    position::MapData data(size, std::string(size, '#'));
+    auto at = [&data](const position::Position& pos) -> char&
+    {
+        return data[pos.y][pos.x];
+    };
+    auto inside = [size](const position::Position& pos)
+    {
+        return pos.y > 0 && pos.x > 0 && pos.y < size - 1 && pos.x < size - 1;
+    };
+
+    std::vector<position::Position> stack{{size - 2, 1}};
+    at(stack.back()) = '.';
+    while (!std::empty(stack))
+    {
+        auto pos = stack.back();
+        std::array<position::Direction, 4> candidates{};
+        int count = 0;
+        for (auto direction : position::directions)
+        {
+            auto target = pos + direction + direction;
+            if (inside(target) && at(target) == '#')
+                candidates[count++] = direction;
+        }
+        if (count == 0)
+        {
+            stack.pop_back();
+            continue;
+        }
+        auto direction = candidates[next(count)];
+        at(pos + direction) = '.';
+        at(pos + direction + direction) = '.';
+        stack.push_back(pos + direction + direction);
+    }
+    for (int i = 0; i < size * size / 100; ++i)
+    {
+        position::Position pos{1 + next(size - 2), 1 + next(size - 2)};
+        if (pos.y % 2 != pos.x % 2)
+            at(pos) = '.';
+    }
+    at({size - 2, 1}) = 'S';
+    at({1, size - 2}) = 'E';
+    return data;
+}
+
 namespace part1
 {
 
@@ -193,6 +807,7 @@ void solution()
     Maze maze{input()};
     auto [cost, cells] = maze.searchWithTracking();
     fmt::print("Part I Solution: {}\n", cost);
+    assert(cost == 94444);
 }
 
 }  // namespace part1
@@ -207,12 +822,18 @@ void test()
         auto [cost, cells] = maze.searchWithTracking();
         fmt::print("Part II Test 1: {}\n", cells);
         assert(cells == 45);
+        JunctionGraph graph{maze};
+        auto contracted = graph.search(maze.start, maze.startDirection, maze.end);
+        assert(contracted == std::pair(cost, cells));
     }
     {
         Maze maze{testData2};
         auto [cost, cells] = maze.searchWithTracking();
         fmt::print("Part II Test 2: {}\n", cells);
         assert(cells == 64);
+        JunctionGraph graph{maze};
+        auto contracted = graph.search(maze.start, maze.startDirection, maze.end);
+        assert(contracted == std::pair(cost, cells));
     }
 }
 
@@ -220,12 +841,95 @@ void solution()
 {
     Maze maze{input()};
     auto [cost, cells] = maze.searchWithTracking();
-    fmt::print("Part II Solution: {}\n", cells); // 502
+    fmt::print("Part II Solution: {}\n", cells);
+    assert(cells == 502);
+    JunctionGraph graph{maze};
+    auto contracted = graph.search(maze.start, maze.startDirection, maze.end);
+    assert(contracted == std::pair(cost, cells));
+    RoutesToEnd routes{maze, maze.end};
+    assert(routes.query(maze.start, maze.startDirection) == std::pair(cost, cells));
+}
+
+void benchmark()
+{
+    Maze maze{generateMaze(2001, 16)};
+    auto full = util::withTimer("full search, 2001x2001 maze",
+                                [&]
+                                {
+                                    return maze.searchWithTracking();
+                                });
+    auto graph = util::withTimer("junction graph, 2001x2001 maze",
+                                 [&]
+                                 {
+                                     return JunctionGraph{maze};
+                                 });
+    auto contracted = util::withTimer("junction graph search",
+                                      [&]
+                                      {
+                                          return graph.search(
+                                              maze.start, maze.startDirection, maze.end);
+                                      });
+    fmt::print("Benchmark: {} junctions, cost {}, {} tiles\n",
+               graph.size(),
+               full.first,
+               full.second);
+    util::verify("junction graph search matches full search", contracted == full);
+}
+
+/**
+ * Latency of (start, facing) queries to the puzzle end: cold, a full search
+ * per query, against warm, queries on a cached RoutesToEnd.
+ */
+void queryBenchmark()
+{
+    constexpr std::size_t queries = 200;
+    Maze maze{input()};
+    std::vector<std::pair<position::Position, position::DirectionIndex>> starts;
+    util::Lcg random{16};
+    while (std::size(starts) < queries)
+    {
+        auto cell = random.below(std::size(maze.open));
+        if (maze.open[cell])
+        {
+            position::Position pos{static_cast<int>(cell / maze.width),
+                                   static_cast<int>(cell % maze.width)};
+            starts.emplace_back(pos, static_cast<position::DirectionIndex>(random.below(4)));
+        }
+    }
+
+    auto cold = util::withTimer<std::chrono::microseconds>(
+        "200 cold queries",
+        [&]
+        {
+            std::vector<std::pair<std::size_t, std::size_t>> result;
+            for (auto [start, facing] : starts)
+            {
+                maze.start = start;
+                maze.startDirection = facing;
+                result.push_back(maze.searchWithTracking());
+            }
+            return result;
+        });
+    auto routes = util::withTimer<std::chrono::microseconds>("reverse distance field",
+                                                             [&]
+                                                             {
+                                                                 return RoutesToEnd{maze, maze.end};
+                                                             });
+    auto warm = util::withTimer<std::chrono::microseconds>(
+        "200 warm queries",
+        [&]
+        {
+            std::vector<std::pair<std::size_t, std::size_t>> result;
+            for (auto [start, facing] : starts)
+                result.push_back(routes.query(start, facing));
+            return result;
+        });
+    util::verify("warm queries match cold queries", warm == cold);
 }
 }  // namespace part2
 }  // namespace aoc2024::day16
 
-int main()
+int main(int argc, char** argv)
 {
     using namespace aoc2024;
     using namespace aoc2024::day16;
@@ -233,5 +937,10 @@ int main()
     part1::solution();
     part2::test();
     part2::solution();
+    if (util::benchmarkRequested(argc, argv))
+    {
+        part2::benchmark();
+        part2::queryBenchmark();
+    }
     return 0;
 }
\ No newline at end of file
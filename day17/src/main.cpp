@@ -1,11 +1,21 @@
-#include "util/functional.h"
+#include "util/parallel.h"
+#include "util/util.h"
 
 #include <range/v3/all.hpp>
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <optional>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace aoc2024::day17
@@ -164,6 +174,304 @@ struct Vm
 };
 
 
+/**
+ * A Program instruction with its operand resolved ahead of time.
+ */
+struct Instruction
+{
+    static constexpr std::uint8_t halt = 8;  // pseudo-opcode past the last instruction
+
+    std::uint8_t opcode;
+    std::uint8_t operand;  // operand file index, literal or jump target
+};
+
+/**
+ * Validates a Program and decodes it, appending a halt. Registers live in an
+ * operand file {0, 1, 2, 3, A, B, C}, so a combo operand is its own index
+ * into it (no switch), literals are stored ready to use and jump targets are
+ * instruction indices.
+ */
+std::vector<Instruction> compile(Vm::Program program)
+{
+    std::vector<Instruction> code;
+    if (std::size(program) % 2 != 0)
+        throw std::invalid_argument{"Program of odd length"};
+    auto instructions = static_cast<int>(std::size(program) / 2);
+    for (std::size_t ip = 0; ip < std::size(program); ip += 2)
+    {
+        auto opcode = program[ip];
+        auto operand = program[ip + 1];
+        if (opcode < 0 || opcode > 7 || operand < 0 || operand > 7)
+            throw std::invalid_argument{"Not a 3-bit program"};
+        switch (static_cast<Vm::OpCode>(opcode))
+        {
+        case Vm::OpCode::adv:
+        case Vm::OpCode::bst:
+        case Vm::OpCode::out:
+        case Vm::OpCode::bdv:
+        case Vm::OpCode::cdv:
+            if (operand == 7)
+                throw std::invalid_argument{"Invalid combo operand"};
+            break;
+        case Vm::OpCode::jnz:
+            if (operand % 2 != 0)
+                throw std::invalid_argument{"Jump between instructions"};
+            operand = std::min(operand / 2, instructions);
+            break;
+        default:
+            break;
+        }
+        code.push_back(
+            {static_cast<std::uint8_t>(opcode), static_cast<std::uint8_t>(operand)});
+    }
+    code.push_back({Instruction::halt, 0});
+    return code;
+}
+
+/**
+ * A Program compiled once and run with computed-goto dispatch. Output goes to
+ * a buffer reused across runs, which only grows when a run outputs more than
+ * it holds.
+ */
+class CompiledVm
+{
+public:
+    using RegisterType = Vm::RegisterType;
+
+    explicit CompiledVm(Vm::Program program, std::size_t outputCapacity = 64)
+        : code(compile(program))
+        , output(outputCapacity)
+    {}
+
+    /**
+     * Runs from the given registers until the program halts or `limit`
+     * values are output; returns the output. The registers must be
+     * non-negative. The output buffer starts at `outputCapacity` values and
+     * grows if a run outputs more.
+     */
+    std::span<const std::uint8_t> run(
+        RegisterType a,
+        RegisterType b = 0,
+        RegisterType c = 0,
+        std::size_t limit = std::numeric_limits<std::size_t>::max())
+    {
+        // no instruction turns a non-negative register negative, so checking
+        // once here keeps every shift count in divide() non-negative
+        util::verify("registers are non-negative", a >= 0 && b >= 0 && c >= 0);
+        constexpr std::size_t ra = 4, rb = 5, rc = 6;
+        std::array<RegisterType, 7> file{0, 1, 2, 3, a, b, c};
+        // shifting a non-negative register by 63 or more leaves 0
+        auto divide = [&file](std::uint8_t operand)
+        {
+            return file[ra] >> std::min<RegisterType>(file[operand], 63);
+        };
+        if (limit == 0)
+        {
+            return {};
+        }
+        std::size_t written = 0;
+        std::uint64_t count = 0;
+        const auto* ip = std::data(code);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"  // labels as values
+        static constexpr std::array<void*, 9> dispatch{
+            &&adv, &&bxl, &&bst, &&jnz, &&bxc, &&out, &&bdv, &&cdv, &&halt};
+        static_assert(std::size(dispatch) == Instruction::halt + 1);
+        goto* dispatch[ip->opcode];
+
+    adv:
+        file[ra] = divide(ip->operand);
+        ++ip, ++count;
+        goto* dispatch[ip->opcode];
+    bxl:
+        file[rb] ^= ip->operand;
+        ++ip, ++count;
+        goto* dispatch[ip->opcode];
+    bst:
+        file[rb] = file[ip->operand] & 7;
+        ++ip, ++count;
+        goto* dispatch[ip->opcode];
+    jnz:
+        ip = file[ra] != 0 ? std::data(code) + ip->operand : ip + 1;
+        ++count;
+        goto* dispatch[ip->opcode];
+    bxc:
+        file[rb] ^= file[rc];
+        ++ip, ++count;
+        goto* dispatch[ip->opcode];
+    out:
+        if (written == std::size(output))
+        {
+            output.resize(std::max<std::size_t>(2 * written, 64));
+        }
+        output[written++] = static_cast<std::uint8_t>(file[ip->operand] & 7);
+        ++ip, ++count;
+        if (written == limit)
+            goto halt;
+        goto* dispatch[ip->opcode];
+    bdv:
+        file[rb] = divide(ip->operand);
+        ++ip, ++count;
+        goto* dispatch[ip->opcode];
+    cdv:
+        file[rc] = divide(ip->operand);
+        ++ip, ++count;
+        goto* dispatch[ip->opcode];
+#pragma GCC diagnostic pop
+
+    halt:
+        executed += count;
+        return {std::data(output), written};
+    }
+
+    /** Instructions executed by all runs so far. */
+    std::uint64_t instructions() const { return executed; }
+
+private:
+    std::vector<Instruction> code;
+    std::vector<std::uint8_t> output;
+    std::uint64_t executed = 0;
+};
+
+// one register in every lane, kept in SIMD registers by the vector extension;
+// unsigned, as AVX2 only has logical variable 64-bit shifts
+typedef std::uint64_t RegisterVector8 __attribute__((vector_size(8 * 8)));
+typedef std::uint64_t RegisterVector16 __attribute__((vector_size(16 * 8)));
+
+/**
+ * A compiled Program run for `Lanes` values of A at once. Every register is
+ * a vector of lanes and every instruction a single vector operation: 8 64-bit
+ * lanes fill one AVX-512 or two AVX2 registers, but only when the build
+ * targets them (-DDAY17_NATIVE=ON); the baseline x86-64 build has SSE2 alone
+ * and barely beats CompiledVm. The lanes share the instruction pointer: a
+ * lane whose A is zero at a jnz, or whose output is full, is masked off and
+ * stops recording output, and the batch halts once every lane is masked.
+ * That is only right when leaving the loop means halting, so jnz has to be
+ * the last instruction.
+ */
+template <std::size_t Lanes = 8>
+class BatchVm
+{
+public:
+    using RegisterType = Vm::RegisterType;
+    using Registers = std::array<RegisterType, Lanes>;
+    using Vector = std::conditional_t<Lanes == 8, RegisterVector8, RegisterVector16>;
+    static_assert(sizeof(Vector) == sizeof(Registers), "8 or 16 lanes");
+
+    explicit BatchVm(Vm::Program program, std::size_t outputCapacity = 64)
+        : code(compile(program))
+        , capacity(outputCapacity)
+        , buffer(Lanes * (outputCapacity + 1))  // + 1: masked lanes write to a spare slot
+    {
+        // code ends in the program's last instruction and the halt
+        for (std::size_t ip = 0; ip + 2 < std::size(code); ++ip)
+        {
+            if (code[ip].opcode == std::to_underlying(Vm::OpCode::jnz))
+                throw std::invalid_argument{"Lanes would diverge: jnz before the end"};
+        }
+    }
+
+    /**
+     * Runs every lane from its A (B and C start at 0) until it halts or
+     * outputs `limit` values; see output(lane).
+     */
+    void run(const Registers& a, std::size_t limit = std::numeric_limits<std::size_t>::max())
+    {
+        constexpr std::size_t ra = 4, rb = 5, rc = 6;
+        std::array<Vector, 7> file{};
+        for (std::uint64_t literal = 0; literal < 4; ++literal)
+            file[literal] += literal;
+        for (std::size_t lane = 0; lane < Lanes; ++lane)
+            file[ra][lane] = static_cast<std::uint64_t>(a[lane]);
+        limit = std::min(limit, capacity);
+        auto stride = capacity + 1;
+        written = Vector{};
+        Vector active{};  // all bits set in an active lane
+        if (limit > 0)
+            active = ~active;
+
+        auto divide = [&file](std::size_t target, std::uint8_t operand)
+        {
+            Vector shift = file[operand];
+            auto tooFar = static_cast<Vector>(shift > 63);  // such shifts leave 0
+            file[target] = file[ra] >> ((shift & ~tooFar) | (tooFar & 63));
+        };
+        auto anyActive = [&active]
+        {
+            std::uint64_t any = 0;
+            for (std::size_t lane = 0; lane < Lanes; ++lane)
+                any |= active[lane];
+            return any != 0;
+        };
+
+        if (!anyActive())
+            return;
+        // a plain switch: one dispatch serves every lane, so computed goto buys little
+        for (std::size_t ip = 0;; ++ip)
+        {
+            auto [opcode, operand] = code[ip];
+            switch (opcode)
+            {
+            case std::to_underlying(Vm::OpCode::adv):
+                divide(ra, operand);
+                break;
+            case std::to_underlying(Vm::OpCode::bxl):
+                file[rb] ^= std::uint64_t{operand};
+                break;
+            case std::to_underlying(Vm::OpCode::bst):
+                file[rb] = file[operand] & 7;
+                break;
+            case std::to_underlying(Vm::OpCode::jnz):
+                active &= static_cast<Vector>(file[ra] != 0);
+                if (!anyActive())
+                    return;
+                // the next increment lands on the target
+                ip = static_cast<std::size_t>(operand) - 1;
+                break;
+            case std::to_underlying(Vm::OpCode::bxc):
+                file[rb] ^= file[rc];
+                break;
+            case std::to_underlying(Vm::OpCode::out):
+            {
+                Vector value = file[operand] & 7;
+                for (std::size_t lane = 0; lane < Lanes; ++lane)
+                {
+                    auto slot = static_cast<std::size_t>(written[lane]);
+                    buffer[lane * stride + slot] = static_cast<std::uint8_t>(value[lane]);
+                }
+                written -= active;  // active lanes are -1
+                active &= static_cast<Vector>(written < limit);
+                if (!anyActive())
+                    return;
+                break;
+            }
+            case std::to_underlying(Vm::OpCode::bdv):
+                divide(rb, operand);
+                break;
+            case std::to_underlying(Vm::OpCode::cdv):
+                divide(rc, operand);
+                break;
+            default:  // halt
+                return;
+            }
+        }
+    }
+
+    /** Output of a lane in the last run. */
+    std::span<const std::uint8_t> output(std::size_t lane) const
+    {
+        return {std::data(buffer) + lane * (capacity + 1),
+                static_cast<std::size_t>(written[lane])};
+    }
+
+private:
+    std::vector<Instruction> code;
+    std::size_t capacity;
+    std::vector<std::uint8_t> buffer;
+    Vector written{};
+};
+
 /*
  * {
  *    b <- a mod 8 (1000  1 10 11 100 101 110 111 1000)
@@ -194,59 +502,327 @@ void test()
 {
     std::vector<int> program{0, 1, 5, 4, 3, 0};
     Vm vm{729};
-    fmt::print("Part I Test: {}\n", fmt::join(vm.execute(program), ","));
+    auto out = vm.execute(program);
+    fmt::print("Part I Test: {}\n", fmt::join(out, ","));
+    assert(fmt::format("{}", fmt::join(out, ",")) == "4,6,3,5,6,3,5,2,1,0");
+
+    CompiledVm compiled{program};
+    assert(::ranges::equal(compiled.run(729), out));
 }
 
 void solution()
 {
     std::vector<int> program{2, 4, 1, 1, 7, 5, 1, 5, 0, 3, 4, 3, 5, 5, 3, 0};
-    Vm vm{56256477};
-    fmt::print("Part I Solution: {}\n", fmt::join(vm.execute(program), ","));
+    CompiledVm vm{program};
+    auto solution = fmt::format("{}", fmt::join(vm.run(56256477), ","));
+    fmt::print("Part I Solution: {}\n", solution);
+    assert(solution == "4,1,5,3,1,5,3,5,7");
+}
+
+/**
+ * Compiled VM throughput over many registers, checked against Vm.
+ */
+void benchmark()
+{
+    std::vector<int> program{2, 4, 1, 1, 7, 5, 1, 5, 0, 3, 4, 3, 5, 5, 3, 0};
+    constexpr std::size_t runs = 1'000'000;
+    CompiledVm vm{program};
+    util::Lcg random{17};
+    std::vector<Vm::RegisterType> registers;
+    for (std::size_t i = 0; i < runs; ++i)
+        registers.push_back(static_cast<Vm::RegisterType>(random() >> 16));  // 48 bits
+
+    auto checksum = util::withTimer("compiled VM, 10^6 runs",
+                                    [&]
+                                    {
+                                        std::uint64_t result = 0;
+                                        for (auto a : registers)
+                                        {
+                                            for (auto value : vm.run(a))
+                                                result = result * 8 + value;
+                                        }
+                                        return result;
+                                    });
+    fmt::print("Benchmark: {} instructions, checksum {}\n", vm.instructions(), checksum);
+
+    for (auto a : registers | ::ranges::views::take(1000))
+    {
+        Vm reference{a};
+        util::verify("compiled VM matches Vm",
+                     ::ranges::equal(vm.run(a), reference.execute(program)));
+    }
 }
 }  // namespace part1
 namespace part2
 {
 
-Vm::RegisterType search(std::span<const int> program)
+/**
+ * How a program consumes register A, for programs of the usual quine shape:
+ * one pass of the body per output group, ending in `jnz 0`, with A shifted
+ * right by a constant exactly once per pass and B and C recomputed from A
+ * before they are read. Each pass then only depends on the A it starts with,
+ * so the output of A is the output of its first pass followed by the output
+ * of A >> shift.
+ */
+struct LoopShape
 {
-    auto searcher =  //
-        [&](this auto& self, Vm::RegisterType a, int pos) -> std::optional<Vm::RegisterType>
+    int shift;            // bits of A consumed per pass
+    std::size_t outputs;  // values output per pass
+};
+
+LoopShape analyzeLoop(std::span<const int> program)
+{
+    auto unsupported = [](const char* reason) { return std::invalid_argument{reason}; };
+    if (std::size(program) < 2 || std::size(program) % 2 != 0)
+        throw unsupported("Program of odd length");
+    auto jump = program.last(2);
+    if (jump[0] != std::to_underlying(Vm::OpCode::jnz) || jump[1] != 0)
+        throw unsupported("Program does not end in jnz 0");
+
+    LoopShape shape{.shift = 0, .outputs = 0};
+    bool bDefined = false, cDefined = false;
+    auto readCombo = [&](int operand)
     {
-        if (pos == 0)
-            return a;
+        if ((operand == 5 && !bDefined) || (operand == 6 && !cDefined))
+            throw unsupported("B or C carried over between passes");
+        if (operand == 7)
+            throw unsupported("Invalid combo operand");
+    };
 
-        for (Vm::RegisterType aVal = a * 8; aVal < (a * 8 + 8); ++aVal)
+    for (std::size_t ip = 0; ip + 2 < std::size(program); ip += 2)
+    {
+        auto operand = program[ip + 1];
+        switch (static_cast<Vm::OpCode>(program[ip]))
         {
-            if (Vm vm{aVal}; vm.execute(program).front() == program[pos - 1])
-            {
-                if (auto result = self(aVal, pos - 1))
-                    return result;
-            }
+        case Vm::OpCode::adv:
+            if (shape.shift != 0 || operand < 1 || operand > 3)
+                throw unsupported("A not shifted by a constant once per pass");
+            shape.shift = operand;
+            break;
+        case Vm::OpCode::bxl:
+            readCombo(5);
+            break;
+        case Vm::OpCode::bst:
+        case Vm::OpCode::bdv:
+            readCombo(operand);
+            bDefined = true;
+            break;
+        case Vm::OpCode::jnz:
+            throw unsupported("Jump inside the loop body");
+        case Vm::OpCode::bxc:
+            readCombo(5);
+            readCombo(6);
+            break;
+        case Vm::OpCode::out:
+            readCombo(operand);
+            ++shape.outputs;
+            break;
+        case Vm::OpCode::cdv:
+            readCombo(operand);
+            cDefined = true;
+            break;
+        default:
+            throw unsupported("Not a 3-bit program");
         }
+    }
+    if (shape.shift == 0 || shape.outputs == 0)
+        throw unsupported("Loop does not consume A or does not output");
+    return shape;
+}
+
+/**
+ * Smallest A for which the program outputs `target`, or nothing.
+ *
+ * Builds A from its most significant pass down: a candidate covering the
+ * last k output groups extends to (a << shift) | d, which keeps the output
+ * of a and adds one group in front, so only the first group of the extension
+ * needs running. The candidate tree is explored breadth-wise; each level's
+ * extensions are checked in parallel, one compiled VM per worker. Children
+ * are generated in increasing order from an increasing frontier, so the
+ * first survivor of the last level is the minimum.
+ */
+std::optional<Vm::RegisterType> findRegisterA(std::span<const int> program,
+                                              std::span<const int> target)
+{
+    auto [shift, outputs] = analyzeLoop(program);
+    if (std::empty(target) || std::size(target) % outputs != 0)
         return std::nullopt;
+    auto passes = std::size(target) / outputs;
+    if (passes * static_cast<std::size_t>(shift)
+        >= std::numeric_limits<Vm::RegisterType>::digits)
+    {
+        throw std::invalid_argument{"Register A would overflow"};
+    }
+
+    constexpr std::size_t chunkSize = 4096;
+    auto children = std::size_t{1} << shift;
+    std::vector<CompiledVm> vms;
+    std::vector<Vm::RegisterType> frontier{0};
+    std::vector<std::uint8_t> matches;
+    auto candidate = [&](std::size_t i)
+    {
+        return (frontier[i / children] << shift) | static_cast<Vm::RegisterType>(i % children);
     };
-    return *searcher(0, std::ssize(program));
+    for (auto pass = passes; pass-- > 0 && !std::empty(frontier);)
+    {
+        auto expected = target.subspan(pass * outputs, outputs);
+        auto count = std::size(frontier) * children;
+        auto chunks = (count + chunkSize - 1) / chunkSize;
+        vms.resize(util::parallel::workerCount(chunks), CompiledVm{program, outputs});
+        matches.assign(count, 0);
+        util::parallel::forEachIndex(
+            chunks,
+            [&](std::size_t chunk, std::size_t worker)
+            {
+                auto end = std::min(count, (chunk + 1) * chunkSize);
+                for (auto i = chunk * chunkSize; i < end; ++i)
+                {
+                    // A = 0 would stop after a single pass
+                    auto a = candidate(i);
+                    auto output = vms[worker].run(a, 0, 0, outputs);
+                    matches[i] = a != 0 && ::ranges::equal(output, expected);
+                }
+            });
+
+        std::vector<Vm::RegisterType> next;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (matches[i])
+                next.push_back(candidate(i));
+        }
+        frontier = std::move(next);
+    }
+    if (std::empty(frontier))
+        return std::nullopt;
+    return frontier.front();
+}
+
+/**
+ * Smallest A in [first, last) for which the program outputs `target`, by
+ * brute force: lanes of a BatchVm, chunks of batches spread over threads.
+ */
+std::optional<Vm::RegisterType> searchRange(std::span<const int> program,
+                                            std::span<const int> target,
+                                            Vm::RegisterType first,
+                                            Vm::RegisterType last)
+{
+    using Batch = BatchVm<8>;
+    constexpr std::size_t lanes = std::tuple_size_v<Batch::Registers>;
+    constexpr std::size_t chunkSize = 1 << 16;
+    auto found = util::parallel::reduceChunks(
+        static_cast<std::size_t>(std::max<Vm::RegisterType>(last - first, 0)),
+        chunkSize,
+        last,
+        [&](std::size_t begin, std::size_t end)
+        {
+            // one more value than the target, so longer outputs do not match
+            Batch vm{program, std::size(target) + 1};
+            for (auto base = begin; base < end; base += lanes)
+            {
+                Batch::Registers a;
+                for (std::size_t lane = 0; lane < lanes; ++lane)
+                {
+                    auto offset = std::min(base + lane, end - 1);  // pad the last batch
+                    a[lane] = first + static_cast<Vm::RegisterType>(offset);
+                }
+                vm.run(a);
+                for (std::size_t lane = 0; lane < lanes; ++lane)
+                {
+                    if (::ranges::equal(vm.output(lane), target))
+                        return a[lane];
+                }
+            }
+            return last;
+        },
+        [](auto lhs, auto rhs) { return std::min(lhs, rhs); });
+    if (found == last)
+        return std::nullopt;
+    return found;
+}
+
+void test()
+{
+    std::vector<int> program{0, 3, 5, 4, 3, 0};
+    auto a = findRegisterA(program, program);
+    fmt::print("Part II Test: {}\n", a.value_or(-1));
+    assert(a == 117440);
+    assert(searchRange(program, program, 0, 1 << 18) == a);
 }
 
 void solution()
 {
     std::vector<int> program{2, 4, 1, 1, 7, 5, 1, 5, 0, 3, 4, 3, 5, 5, 3, 0};
 
-    fmt::print("Part II Solution: {}\n", search(program));
+    auto a = findRegisterA(program, program);
+    fmt::print("Part II Solution: {}\n", a.value_or(-1));
+    assert(a == 164542125272765);
 
     // self-test
-    Vm vm{164542125272765};
+    Vm vm{*a};
     auto out = vm.execute(program);
-    fmt::print("Self-test {}", ::ranges::equal(program, out) ? "passed" : "failed");
+    fmt::print("Self-test {}\n", ::ranges::equal(program, out) ? "passed" : "failed");
+}
+
+/**
+ * Scalar against lane-parallel runs over the same registers, single-threaded.
+ */
+void benchmark()
+{
+    std::vector<int> program{2, 4, 1, 1, 7, 5, 1, 5, 0, 3, 4, 3, 5, 5, 3, 0};
+    constexpr std::size_t runs = 1 << 20;
+    util::Lcg random{17};
+    std::vector<Vm::RegisterType> registers(runs);
+    for (auto& a : registers)
+        a = static_cast<Vm::RegisterType>(random() >> 16);  // 48 bits
+    auto fold = [](std::uint64_t result, std::span<const std::uint8_t> output)
+    {
+        for (auto value : output)
+            result = result * 8 + value;
+        return result * 31 + std::size(output);
+    };
+
+    auto scalar = util::withTimer("compiled VM, 2^20 runs",
+                                  [&]
+                                  {
+                                      CompiledVm vm{program};
+                                      std::uint64_t result = 0;
+                                      for (auto a : registers)
+                                          result = fold(result, vm.run(a));
+                                      return result;
+                                  });
+    auto batched = [&]<std::size_t Lanes>(BatchVm<Lanes> vm)
+    {
+        std::uint64_t result = 0;
+        for (std::size_t base = 0; base < runs; base += Lanes)
+        {
+            typename BatchVm<Lanes>::Registers a;
+            std::copy_n(std::data(registers) + base, Lanes, std::data(a));
+            vm.run(a);
+            for (std::size_t lane = 0; lane < Lanes; ++lane)
+                result = fold(result, vm.output(lane));
+        }
+        return result;
+    };
+    auto lanes8 = util::withTimer("batch VM, 8 lanes",
+                                  [&] { return batched(BatchVm<8>{program}); });
+    auto lanes16 = util::withTimer("batch VM, 16 lanes",
+                                   [&] { return batched(BatchVm<16>{program}); });
+    util::verify("batch VM matches compiled VM", lanes8 == scalar && lanes16 == scalar);
 }
 }  // namespace part2
 }  // namespace aoc2024::day17
 
-int main()
+int main(int argc, char** argv)
 {
     using namespace aoc2024::day17;
     part1::test();
     part1::solution();
+    part2::test();
     part2::solution();
+    if (aoc2024::util::benchmarkRequested(argc, argv))
+    {
+        part1::benchmark();
+        part2::benchmark();
+    }
     return 0;
 }
\ No newline at end of file
@@ -3,8 +3,8 @@
 
 #include <range/v3/all.hpp>
 
+#include <span>
 #include <vector>
-#include <cmath>
 
 namespace aoc2024::day7
 {
@@ -74,53 +74,32 @@ void solution()
 
 namespace part2
 {
-std::uint64_t multiplier(std::uint64_t value)
+/**
+ * Whether the values combine into `target`, searched from the last operand
+ * back: it can only have been added if it is below the target, multiplied if
+ * it divides it and concatenated if the target ends in its digits. Every
+ * branch is a cheap test that usually fails, so far fewer than 3^n operator
+ * combinations are visited than when running the operators forwards.
+ * Intermediate results are positive, as in part I.
+ */
+bool reachable(std::uint64_t target, std::span<const std::uint64_t> values)
 {
-    std::uint64_t result = 1;
-    while (value > 0)
-    {
-        result *= 10;
-        value /= 10;
-    }
-    return result;
+    auto value = values.back();
+    if (std::size(values) == 1)
+        return target == value;
+
+    auto rest = values.first(std::size(values) - 1);
+    if (target > value && reachable(target - value, rest))
+        return true;
+    if (value != 0 && target % value == 0 && reachable(target / value, rest))
+        return true;
+    auto [high, low] = util::splitDigits(target, util::countDigits(value));
+    return low == value && high != 0 && reachable(high, rest);
 }
 
-std::uint64_t solveOne(Input input)
+std::uint64_t solveOne(const Input& input)
 {
-    using namespace ::ranges;
-    std::uint64_t result = input.result;
-    std::vector<std::uint64_t> values = {0};
-    values.reserve(std::pow(3, std::size(input.values)));
-    auto nextStepFilter = [result = input.result](auto v)
-    {
-        return v <= result && v != 0;
-    };
-
-    std::vector<std::uint64_t> newValues;
-    newValues.reserve(values.capacity());
-    for (const auto& value : input.values)
-    {
-        newValues.clear();
-        newValues |= push_back(  //
-            values | views::transform(std::bind_front(std::plus<>{}, value))
-            | views::filter(nextStepFilter));
-        newValues |= push_back(  //
-            values | views::transform(std::bind_front(std::multiplies<>{}, value))
-            | views::filter(nextStepFilter));
-        newValues |= push_back(  //
-            values
-            | views::transform(
-                [&value, mult = multiplier(value)](auto v) -> std::uint64_t
-                {
-                    if (std::numeric_limits<std::uint64_t>::max() / mult < v)
-                        return 0;
-                    return v * mult + value;
-                })
-            | views::filter(nextStepFilter));
-        values = std::move(newValues);
-    }
-
-    return contains(values, result) ? result : 0;
+    return reachable(input.result, input.values) ? input.result : 0;
 }
 
 std::uint64_t solve(const std::vector<Input>& inputs)
@@ -150,9 +129,9 @@ int main()
 {
     using namespace aoc2024::day7;
     part1::test();
-    part1::solution();
+    aoc2024::util::withTimer("part1::solution", part1::solution);
 
     part2::test();
-    aoc2024::util::withTimer("part2::solution", part2::solution);
+    aoc2024::util::withTimer<std::chrono::microseconds>("part2::solution", part2::solution);
     return 0;
 }
\ No newline at end of file
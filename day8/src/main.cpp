@@ -1,15 +1,24 @@
 #include "input.h"
 #include "util/position.h"
+#include "util/parallel.h"
+#include "util/numeric.h"
+#include "util/verify.h"
 
-#include <range/v3/all.hpp>
+#include <boost/dynamic_bitset.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <limits>
+#include <numeric>
+#include <print>
+#include <utility>
 #include <vector>
-#include <unordered_set>
 
 namespace aoc2024::day8
 {
 using Position = util::position::Position;
+using Delta = util::position::Delta;
 
 Map testInput()
 {
@@ -29,61 +38,157 @@ Map testInput()
     };
 }
 
-bool inBounds(const Map& map, const Position& position)
+constexpr std::size_t frequencyCount = 10 + 26 + 26;
+
+/**
+ * Frequencies are digits, uppercase and lowercase letters: map them onto
+ * [0, frequencyCount) so antennas can be bucketed without hashing. Any other
+ * character is not an antenna and fails verification.
+ */
+constexpr std::size_t frequencyIndex(char frequency)
 {
-    return position.y >= 0 && position.y < std::ssize(map) && position.x >= 0
-           && position.x < std::ssize(map[0]);
+    if (frequency >= '0' && frequency <= '9')
+        return frequency - '0';
+    if (frequency >= 'A' && frequency <= 'Z')
+        return 10 + (frequency - 'A');
+    util::verify("antenna frequency is a digit or a letter",
+                 frequency >= 'a' && frequency <= 'z');
+    return 10 + 26 + (frequency - 'a');
 }
 
-auto extractAntennas(const Map& map)
+using Antennas = std::array<std::vector<Position>, frequencyCount>;
+
+Antennas extractAntennas(const Map& map)
 {
-    using namespace ::ranges;
-    std::unordered_map<char, std::vector<Position>> antennas;
-    for (const auto& [y, row] : map | views::enumerate)
+    Antennas antennas;
+    for (int y = 0; y < std::ssize(map); ++y)
     {
-        auto line = row | views::enumerate
-                    | views::filter(
-                        [](const auto& val)
-                        {
-                            return val.second != '.';
-                        });
-        for (const auto& [x, frequency] : line)
-            antennas[frequency].emplace_back(y, x);
+        for (int x = 0; x < std::ssize(map[y]); ++x)
+        {
+            if (map[y][x] != '.')
+                antennas[frequencyIndex(map[y][x])].emplace_back(y, x);
+        }
     }
     return antennas;
 }
 
-void print(Map map, const std::unordered_set<Position>& antinodes)
+/**
+ * Antinode locations packed one bit per map cell.
+ */
+struct Antinodes
+{
+    explicit Antinodes(const Map& map)
+        : height{static_cast<int>(std::ssize(map))}
+        , width{static_cast<int>(std::ssize(map[0]))}
+        , cells(static_cast<std::size_t>(height) * width)
+    {}
+
+    bool inBounds(const Position& position) const
+    {
+        return position.y >= 0 && position.y < height && position.x >= 0
+               && position.x < width;
+    }
+
+    bool contains(const Position& position) const
+    {
+        return cells.test(static_cast<std::size_t>(position.y) * width + position.x);
+    }
+
+    void mark(const Position& position)
+    {
+        cells.set(static_cast<std::size_t>(position.y) * width + position.x);
+    }
+
+    /**
+     * Marks `count` cells starting at `first`, `step` apart. On the flattened
+     * grid that is a run with a constant stride, no bounds checks needed.
+     */
+    void markRun(const Position& first, const Delta& step, int count)
+    {
+        auto index = static_cast<std::ptrdiff_t>(first.y) * width + first.x;
+        auto stride = static_cast<std::ptrdiff_t>(step.first) * width + step.second;
+        for (int i = 0; i < count; ++i, index += stride)
+            cells.set(static_cast<std::size_t>(index));
+    }
+
+    Antinodes& operator|=(const Antinodes& other)
+    {
+        cells |= other.cells;
+        return *this;
+    }
+
+    std::size_t count() const { return cells.count(); }
+
+    int height = 0;
+    int width = 0;
+    boost::dynamic_bitset<> cells;
+};
+
+void print(Map map, const Antinodes& antinodes)
 {
-    for (const auto& pos : antinodes)
-        map[pos.y][pos.x] = '#';
+    for (int y = 0; y < antinodes.height; ++y)
+    {
+        for (int x = 0; x < antinodes.width; ++x)
+        {
+            if (antinodes.contains({y, x}))
+                map[y][x] = '#';
+        }
+    }
     for (const auto& row : map)
         std::print("{}\n", row);
 }
 
+/**
+ * Calls `markPair(antinodes, pos1, pos2)` for every pair of antennas sharing
+ * a frequency and returns the number of distinct marked cells.
+ * Work is split by (frequency, first antenna of the pair) rather than by
+ * frequency alone, so a single crowded frequency still spreads across threads.
+ * Each worker marks its own bitset, and they are OR-reduced at the end.
+ */
+Antinodes collectAntinodes(const Map& map, auto markPair)
+{
+    auto antennas = extractAntennas(map);
+
+    std::vector<std::pair<std::size_t, std::size_t>> rows;
+    for (std::size_t frequency = 0; frequency < frequencyCount; ++frequency)
+    {
+        for (std::size_t i = 0; i + 1 < std::size(antennas[frequency]); ++i)
+            rows.emplace_back(frequency, i);
+    }
+
+    std::vector<Antinodes> partial(util::parallel::workerCount(std::size(rows)),
+                                   Antinodes{map});
+    util::parallel::forEachIndex(  //
+        std::size(rows),
+        [&](std::size_t index, std::size_t worker)
+        {
+            auto [frequency, i] = rows[index];
+            const auto& positions = antennas[frequency];
+            for (auto j = i + 1; j < std::size(positions); ++j)
+                markPair(partial[worker], positions[i], positions[j]);
+        });
+
+    for (std::size_t worker = 1; worker < std::size(partial); ++worker)
+        partial[0] |= partial[worker];
+    return std::move(partial[0]);
+}
+
 namespace part1
 {
 int solve(const Map& map)
 {
-    using namespace ::ranges;
-    auto antennas = extractAntennas(map);
-    std::unordered_set<Position> antinodes;
-    for (const auto& [frequency, positions] : antennas)
-    {
-        for (const auto& [i, pos1] : positions | views::enumerate)
+    auto antinodes = collectAntinodes(  //
+        map,
+        [](Antinodes& antinodes, const Position& pos1, const Position& pos2)
         {
-            for (const auto& pos2 : positions | views::drop(i + 1))
-            {
-                auto delta = pos1 - pos2;
-                if (auto first = pos1 + delta; inBounds(map, first))
-                    antinodes.insert(first);
-
-                if (auto second = pos2 - delta; inBounds(map, second))
-                    antinodes.insert(second);
-            }
-        }
-    }
-    return std::ssize(antinodes);
+            auto delta = pos1 - pos2;
+            if (auto first = pos1 + delta; antinodes.inBounds(first))
+                antinodes.mark(first);
+
+            if (auto second = pos2 - delta; antinodes.inBounds(second))
+                antinodes.mark(second);
+        });
+    return static_cast<int>(antinodes.count());
 }
 
 void test()
@@ -102,29 +207,45 @@ void solution()
 
 namespace part2
 {
-
-int solve(const Map& map)
+/**
+ * Range [first, last] of t for which `position + t * step` lies in [0, size).
+ */
+std::pair<int, int> parameterRange(int position, int step, int size)
 {
-    using namespace ::ranges;
-    auto antennas = extractAntennas(map);
-    std::unordered_set<Position> antinodes;
-    for (const auto& [frequency, positions] : antennas)
+    if (step == 0)
     {
-        for (const auto& [i, pos1] : positions | views::enumerate)
-        {
-            for (const auto& pos2 : positions | views::drop(i + 1))
-            {
-                auto delta = pos1 - pos2;
-                for (auto first = pos1; inBounds(map, first); first += delta)
-                    antinodes.insert(first);
-
-                for (auto second = pos2; inBounds(map, second); second -= delta)
-                    antinodes.insert(second);
-            }
-        }
+        return {std::numeric_limits<int>::min(), std::numeric_limits<int>::max()};
     }
+    if (step > 0)
+        return {util::ceilDiv(-position, step), util::floorDiv(size - 1 - position, step)};
+    return {util::ceilDiv(size - 1 - position, step), util::floorDiv(-position, step)};
+}
+
+/**
+ * Every grid point on the line through both antennas is an antinode. Reduce
+ * the delta by its gcd to get the smallest lattice step, find where the line
+ * enters and leaves the map analytically and mark the cells in between as a
+ * single strided run.
+ */
+void markLine(Antinodes& antinodes, const Position& pos1, const Position& pos2)
+{
+    auto [dy, dx] = pos1 - pos2;
+    auto divisor = std::gcd(dy, dx);
+    Delta step{dy / divisor, dx / divisor};
+
+    auto [firstY, lastY] = parameterRange(pos1.y, step.first, antinodes.height);
+    auto [firstX, lastX] = parameterRange(pos1.x, step.second, antinodes.width);
+    auto first = std::max(firstY, firstX);
+    auto last = std::min(lastY, lastX);
+    antinodes.markRun(
+        {pos1.y + first * step.first, pos1.x + first * step.second}, step, last - first + 1);
+}
+
+int solve(const Map& map)
+{
+    auto antinodes = collectAntinodes(map, markLine);
     //        print(map, antinodes);
-    return std::ssize(antinodes);
+    return static_cast<int>(antinodes.count());
 }
 
 void test()
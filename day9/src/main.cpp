@@ -4,149 +4,282 @@
 
 #include <range/v3/all.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <functional>
+#include <limits>
+#include <numeric>
 #include <optional>
+#include <queue>
+#include <span>
 #include <string_view>
 #include <string>
 #include <vector>
-#include <set>
-#include <list>
-#include <map>
 
 namespace aoc2024::day9
 {
-namespace part1
+/**
+ * A run of `size` consecutive blocks of file `id` starting at `offset`.
+ */
+struct File
 {
-std::uint64_t solve(std::string_view input)
+    std::uint64_t id = 0;
+    std::size_t offset = 0;
+    std::size_t size = 0;
+};
+
+// large maps overflow 64 bits (the real input is already at 6.5e12)
+__extension__ using Checksum = unsigned __int128;
+
+/**
+ * Checksum contribution of a run: sum of id * position over its blocks,
+ * as an arithmetic series.
+ */
+constexpr Checksum runChecksum(std::uint64_t id, std::size_t offset, std::size_t size)
 {
-    using namespace ::ranges;
-    using Block = std::optional<int>;
-    std::vector<Block> filesystem;
-    filesystem.reserve(10 * std::size(input));
-    auto sizes = input | views::enumerate
-                 | views::transform(
-                     [](auto val)
-                     {
-                         return std::pair{val.second - '0',
-                                          val.first % 2 == 0 ? Block{val.first / 2}
-                                                             : std::nullopt};
-                     });
-    for (auto [blockSize, val] : sizes)
-        filesystem.resize(filesystem.size() + blockSize, val);
-
-    auto last = std::end(filesystem) - 1;
-    auto first = std::begin(filesystem);
-    for (; last != first;)
+    return Checksum{id} * (size * offset + size * (size - 1) / 2);
+}
+
+constexpr std::size_t checksumLanes = 8;
+constexpr std::size_t checksumPartition = std::size_t{1} << 16;
+
+/**
+ * Sums `term(i)` for i in [0, count) into independent lane accumulators, so
+ * consecutive terms don't form one dependency chain and the loop can be
+ * unrolled/vectorized by the compiler.
+ */
+Checksum sumInLanes(std::size_t count, auto term)
+{
+    std::array<Checksum, checksumLanes> lanes{};
+    std::size_t index = 0;
+    for (; index + checksumLanes <= count; index += checksumLanes)
     {
-        if (first->has_value())
-            ++first;
-        else if (!last->has_value())
-            --last;
-        else
-            std::swap(*first, *last);
+        for (std::size_t lane = 0; lane < checksumLanes; ++lane)
+            lanes[lane] += term(index + lane);
     }
-    return accumulate(  //
-        filesystem
-            | views::take_while(
-                [](const auto& val)
-                {
-                    return val.has_value();
-                })
-            | views::enumerate,
-        std::uint64_t{0},
-        [](auto acc, const auto& val)
+    for (; index < count; ++index)
+        lanes[0] += term(index);
+    return std::accumulate(std::begin(lanes), std::end(lanes), Checksum{0});
+}
+
+/**
+ * Checksum of a layout given as runs; partitions of runs are reduced in
+ * parallel.
+ */
+Checksum checksum(std::span<const File> runs)
+{
+    return util::parallel::reduceChunks(  //
+        std::size(runs),
+        checksumPartition,
+        Checksum{0},
+        [runs](std::size_t begin, std::size_t end)
+        {
+            return sumInLanes(end - begin,
+                              [&](std::size_t index)
+                              {
+                                  const auto& run = runs[begin + index];
+                                  return runChecksum(run.id, run.offset, run.size);
+                              });
+        });
+}
+
+constexpr auto freeBlock = std::numeric_limits<std::uint32_t>::max();
+
+/**
+ * Checksum of a dense layout with one file id (or `freeBlock`) per block.
+ */
+Checksum checksum(std::span<const std::uint32_t> blocks)
+{
+    return util::parallel::reduceChunks(  //
+        std::size(blocks),
+        checksumPartition,
+        Checksum{0},
+        [blocks](std::size_t begin, std::size_t end)
         {
-            return acc + val.first * val.second.value();
+            return sumInLanes(end - begin,
+                              [&](std::size_t index)
+                              {
+                                  auto id = blocks[begin + index];
+                                  return id == freeBlock ? Checksum{0}
+                                                         : Checksum{id} * (begin + index);
+                              });
         });
 }
 
+std::vector<std::uint32_t> toDense(std::span<const File> runs)
+{
+    std::vector<std::uint32_t> blocks;
+    for (const auto& [id, offset, size] : runs)
+    {
+        if (std::size(blocks) < offset + size)
+            blocks.resize(offset + size, freeBlock);
+        std::fill_n(std::begin(blocks) + offset, size, static_cast<std::uint32_t>(id));
+    }
+    return blocks;
+}
+
+std::uint64_t toAnswer(Checksum value)
+{
+    util::verify("checksum fits into 64 bits",
+                 value <= std::numeric_limits<std::uint64_t>::max());
+    return static_cast<std::uint64_t>(value);
+}
+
+namespace part1
+{
+/**
+ * Works directly on the run lengths of the dense map. The left cursor walks
+ * runs front to back: files stay in place, gaps are filled from the file
+ * under the right cursor, which walks file runs back to front and tracks how
+ * many of its blocks are still unmoved. The resulting layout is O(input
+ * length) runs, never one entry per block.
+ */
+std::vector<File> compact(std::string_view input)
+{
+    auto runSize = [input](std::size_t index)
+    {
+        return static_cast<std::size_t>(input[index] - '0');
+    };
+
+    std::vector<File> runs;
+    if (std::empty(input))
+        return runs;
+
+    runs.reserve(std::size(input));
+    std::size_t position = 0;
+    auto right = (std::size(input) - 1) & ~std::size_t{1};  // last file run
+    auto rightRemaining = runSize(right);
+    for (std::size_t left = 0; left <= right; ++left)
+    {
+        if (left == right)
+        {
+            runs.push_back({left / 2, position, rightRemaining});
+            break;
+        }
+
+        if (left % 2 == 0)
+        {
+            runs.push_back({left / 2, position, runSize(left)});
+            position += runSize(left);
+            continue;
+        }
+
+        for (auto gap = runSize(left); gap > 0 && left < right;)
+        {
+            auto moved = std::min(gap, rightRemaining);
+            runs.push_back({right / 2, position, moved});
+            position += moved;
+            gap -= moved;
+            rightRemaining -= moved;
+            if (rightRemaining == 0)
+            {
+                right -= 2;
+                rightRemaining = runSize(right);
+            }
+        }
+    }
+    return runs;
+}
+
+std::uint64_t solve(std::string_view input)
+{
+    return toAnswer(checksum(compact(input)));
+}
+
 void test()
 {
     std::string_view input = "2333133121414131402";
     std::print("{}\n", solve(input));
     assert(solve(input) == 1928);
+
+    auto runs = compact(input);
+    assert(checksum(runs) == checksum(toDense(runs)));
 }
 
 void solution()
 {
     auto solution = solve(input);
     std::print("{}\n", solution);
-    assert(solution = 6461289671426);
+    assert(solution == 6461289671426);
 }
 }  // namespace part1
 
 namespace part2
 {
-struct Block
+constexpr std::size_t maxSpanSize = 9;
+
+/**
+ * Free spans of the disk bucketed by size. Sizes are single digits, so
+ * there is one min-heap of offsets per size, and the leftmost span that fits
+ * a file is the smallest top among the heaps for sizes >= the file size.
+ */
+class FreeSpans
 {
-    bool empty() const { return !id.has_value(); }
-    std::size_t size = 0;
-    std::size_t offset = 0;
-    std::optional<std::uint64_t> id;
+public:
+    void add(std::size_t offset, std::size_t size)
+    {
+        if (size != 0)
+            heaps[size].push(offset);
+    }
+
+    /**
+     * Takes the leftmost span that can hold `size` blocks and lies before
+     * `limit`, returning its offset. The unused tail of the span goes back
+     * into the heap matching its remaining size.
+     */
+    std::optional<std::size_t> take(std::size_t size, std::size_t limit)
+    {
+        std::size_t bestSize = 0;
+        std::size_t bestOffset = limit;
+        for (auto spanSize = size; spanSize <= maxSpanSize; ++spanSize)
+        {
+            if (!heaps[spanSize].empty() && heaps[spanSize].top() < bestOffset)
+            {
+                bestOffset = heaps[spanSize].top();
+                bestSize = spanSize;
+            }
+        }
+        if (bestSize == 0)
+            return std::nullopt;
+
+        heaps[bestSize].pop();
+        add(bestOffset + size, bestSize - size);
+        return bestOffset;
+    }
+
+private:
+    using OffsetHeap =
+        std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<>>;
+    std::array<OffsetHeap, maxSpanSize + 1> heaps;
 };
 
 std::uint64_t solve(std::string_view input)
 {
     using namespace ::ranges;
 
-    auto sizes = input  //
-                 | views::enumerate
-                 | views::transform(
-                     [](auto val)
-                     {
-                         return std::pair{val.second - '0',
-                                          val.first % 2 != 0
-                                              ? std::nullopt
-                                              : std::optional{val.first / 2}};
-                     });
-
-    // after unsuccessful attempt to use std::map - screw it, brute force
-    using Filessystem = std::list<Block>;
-    Filessystem fs;
-    for (std::size_t offset = 0; auto [blockSize, id] : sizes)
+    std::vector<File> files;
+    files.reserve(std::size(input) / 2 + 1);
+    FreeSpans freeSpans;
+    for (std::size_t index = 0, offset = 0; index < std::size(input); ++index)
     {
-        if (blockSize == 0)
-            continue;
-        fs.emplace_back(blockSize, offset, id);
-        offset += blockSize;
+        auto size = static_cast<std::size_t>(input[index] - '0');
+        if (index % 2 == 0)
+            files.push_back({index / 2, offset, size});
+        else
+            freeSpans.add(offset, size);
+        offset += size;
     }
 
-    // we don't preserve order, it doesn't impact the result
-    for (auto& [fileSize, fileOffset, _] :
-         fs | views::reverse | views::filter(std::not_fn(&Block::empty)))
+    // files are moved once, highest id first; space they free is to the right
+    // of every file still to move, so it never needs to be returned
+    for (auto& file : files | views::reverse)
     {
-        auto emptyBlocks = fs | views::filter(&Block::empty)
-                           | views::take_while(
-                               [fileOffset](const auto& block)
-                               {
-                                   return block.offset < fileOffset;
-                               });
-        auto& [emptySize, emptyOffset, _2] =
-            *find_if(emptyBlocks,
-                     std::bind_front(std::greater_equal{}, fileSize),
-                     &Block::size);
-
-        if (emptyOffset > fileOffset)
-            continue;
-
-        // update file block
-        fileOffset = emptyOffset;
-
-        // update empty block
-        emptySize -= fileSize;
-        emptyOffset += fileSize;
+        if (auto offset = freeSpans.take(file.size, file.offset))
+            file.offset = *offset;
     }
 
-    return accumulate(  //
-        fs | views::filter(std::not_fn(&Block::empty))
-            | views::transform(
-                [](const auto& block)
-                {
-                    const auto& [size, offset, id] = block;
-                    return *id * size * offset + (*id * size * (size - 1)) / 2;
-                }),
-        std::uint64_t{0},
-        std::plus{});
+    return toAnswer(checksum(files));
 }
 
 
@@ -176,7 +309,7 @@ void solution()
 {
     auto solution = solve(input);
     std::print("{}\n", solution);
-    assert(solution = 6488291456470);
+    assert(solution == 6488291456470);
 }
 }  // namespace part2
 }  // namespace aoc2024::day9
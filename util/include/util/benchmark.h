@@ -5,8 +5,12 @@
 #include <fmt/format.h>
 #include <fmt/chrono.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <functional>
+#include <ranges>
+#include <span>
 #include <string_view>
 
 namespace aoc2024::util
@@ -30,4 +34,42 @@ auto withTimer(std::string_view label, auto&& func)
     return std::invoke(std::forward<decltype(func)>(func));
 }
 
+/**
+ * Benchmarks only run when asked for with `--benchmark`, so a plain run of a
+ * day is just its tests and solutions.
+ */
+inline bool benchmarkRequested(int argc, char** argv)
+{
+    return std::ranges::any_of(std::span(argv, argc) | std::views::drop(1),
+                               [](std::string_view arg)
+                               {
+                                   return arg == "--benchmark";
+                               });
+}
+
+/**
+ * Knuth's MMIX linear congruential generator: reproducible benchmark inputs
+ * without <random>. Its low bits are weak, so below() draws from the high
+ * ones.
+ */
+class Lcg
+{
+public:
+    explicit constexpr Lcg(std::uint64_t seed)
+        : state{seed}
+    {}
+
+    constexpr std::uint64_t operator()()
+    {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        return state;
+    }
+
+    /** A value in [0, limit). */
+    constexpr std::uint64_t below(std::uint64_t limit) { return ((*this)() >> 33) % limit; }
+
+private:
+    std::uint64_t state;
+};
+
 }  // namespace aoc2024::util
@@ -1,19 +1,54 @@
 #pragma once
 
+#include <array>
+#include <bit>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <utility>
 
 namespace aoc2024::util
 {
-constexpr auto countDigits(std::integral auto pebble)
+/**
+ * 10^0 ... 10^19, every power of ten representable in 64 bits.
+ */
+inline constexpr auto powersOf10 = []
 {
-    std::uint8_t counter = (pebble == 0);
-    while (pebble > 0)
-    {
-        pebble /= 10;
-        ++counter;
-    }
-    return counter;
+    std::array<std::uint64_t, std::numeric_limits<std::uint64_t>::digits10 + 1> result{};
+    result[0] = 1;
+    for (std::size_t i = 1; i < std::size(result); ++i)
+        result[i] = result[i - 1] * 10;
+    return result;
+}();
+
+/**
+ * Number of decimal digits of a non-negative value (0 has one digit).
+ * The bit width gives log10 up to an off-by-one (1233 / 4096 ~ log10(2)),
+ * which a single comparison against the power table settles: no loop,
+ * no division.
+ */
+constexpr std::uint8_t countDigits(std::integral auto value)
+{
+    auto number = static_cast<std::uint64_t>(value) | 1;
+    auto estimate = (std::bit_width(number) * 1233) >> 12;
+    return static_cast<std::uint8_t>(estimate + 1 - (number < powersOf10[estimate]));
+}
+
+/**
+ * Splits a value into its leading digits and its `lowDigits` trailing ones:
+ * splitDigits(253000, 3) == {253, 0}. Asking for at least as many digits as
+ * a 64-bit value can have (20) leaves no leading digits.
+ */
+constexpr std::pair<std::uint64_t, std::uint64_t> splitDigits(std::uint64_t value,
+                                                              std::size_t lowDigits)
+{
+    if (lowDigits >= std::size(powersOf10))
+        return {0, value};
+    auto divisor = powersOf10[lowDigits];
+    return {value / divisor, value % divisor};
 }
 
 constexpr inline bool isEven(std::integral auto number)
@@ -23,7 +58,173 @@ constexpr inline bool isEven(std::integral auto number)
 
 constexpr inline bool isOdd(std::integral auto number)
 {
-    return number % 2 == 0;
+    return number % 2 != 0;
+}
+
+/**
+ * Integer division rounding towards negative/positive infinity
+ * (built-in division truncates towards zero).
+ */
+constexpr auto floorDiv(std::signed_integral auto numerator,
+                        std::signed_integral auto denominator)
+{
+    auto quotient = numerator / denominator;
+    bool inexact = numerator % denominator != 0;
+    return quotient - (inexact && ((numerator < 0) != (denominator < 0)));
+}
+
+constexpr auto ceilDiv(std::signed_integral auto numerator,
+                       std::signed_integral auto denominator)
+{
+    auto quotient = numerator / denominator;
+    bool inexact = numerator % denominator != 0;
+    return quotient + (inexact && ((numerator < 0) == (denominator < 0)));
+}
+
+/**
+ * Extended Euclid: {g, x, y} with a * x + b * y == g == gcd(a, b), g >= 0.
+ */
+template <std::signed_integral T>
+constexpr std::tuple<T, T, T> extendedGcd(T a, T b)
+{
+    T x = 1, y = 0;
+    T nextX = 0, nextY = 1;
+    while (b != 0)
+    {
+        auto quotient = a / b;
+        a = std::exchange(b, a - quotient * b);
+        x = std::exchange(nextX, x - quotient * nextX);
+        y = std::exchange(nextY, y - quotient * nextY);
+    }
+    if (a < 0)
+        return {-a, -x, -y};
+    return {a, x, y};
+}
+
+/**
+ * Chinese remainder theorem for two congruences x = a (mod m), x = b (mod n)
+ * with positive moduli, not necessarily coprime: {x, lcm(m, n)} with
+ * 0 <= x < lcm(m, n), or nothing when the congruences contradict each other.
+ */
+template <std::signed_integral T>
+constexpr std::optional<std::pair<T, T>> chineseRemainder(T a, T m, T b, T n)
+{
+    auto [g, p, q] = extendedGcd(m, n);
+    auto difference = b - a;
+    if (difference % g != 0)
+        return std::nullopt;
+
+    auto modulus = m / g * n;
+    auto step = n / g;
+    // k = difference / g * p (mod n / g) solves a + k * m = b (mod n)
+    auto k = (difference / g % step) * (p % step) % step;
+    auto x = (a + m * k) % modulus;
+    return std::pair{x < 0 ? x + modulus : x, modulus};
+}
+
+namespace detail
+{
+constexpr std::uint8_t countDigitsByDivision(std::uint64_t value)
+{
+    std::uint8_t counter = (value == 0);
+    for (; value > 0; value /= 10)
+        ++counter;
+    return counter;
+}
+
+// every digit-count boundary, both sides
+constexpr bool checkDigitBoundaries()
+{
+    for (std::size_t digits = 1; digits < std::size(powersOf10); ++digits)
+    {
+        auto power = powersOf10[digits];
+        if (countDigits(power - 1) != digits || countDigits(power) != digits + 1)
+            return false;
+        if (countDigits(power + 1) != digits + 1 || countDigits(power / 2) != digits)
+            return false;
+    }
+    return countDigits(0) == 1 && countDigits(1) == 1
+           && countDigits(std::numeric_limits<std::uint64_t>::max()) == 20;
+}
+
+// every value of the first few digit lengths against the division loop
+constexpr bool checkSmallValues()
+{
+    for (std::uint64_t value = 0; value <= 10'000; ++value)
+    {
+        if (countDigits(value) != countDigitsByDivision(value))
+            return false;
+    }
+    return true;
+}
+
+// splitting at every position and joining the halves back restores the value
+constexpr bool checkSplitDigits()
+{
+    constexpr std::uint64_t value = 12345678901234567890u;
+    for (std::size_t lowDigits = 0; lowDigits < 20; ++lowDigits)
+    {
+        auto [high, low] = splitDigits(value, lowDigits);
+        if (high * powersOf10[lowDigits] + low != value || low >= powersOf10[lowDigits])
+            return false;
+    }
+    using Split = std::pair<std::uint64_t, std::uint64_t>;
+    return splitDigits(253000, 3) == Split{253, 0} && splitDigits(value, 20) == Split{0, value}
+           && splitDigits(value, countDigits(value)) == Split{0, value};
+}
+
+static_assert(checkDigitBoundaries());
+static_assert(checkSmallValues());
+static_assert(checkSplitDigits());
+static_assert(isEven(2) && !isEven(3) && isOdd(3) && !isOdd(2));
+static_assert(floorDiv(-7, 2) == -4 && ceilDiv(-7, 2) == -3);
+static_assert(floorDiv(7, -2) == -4 && ceilDiv(7, 2) == 4 && floorDiv(6, 3) == 2);
+
+constexpr bool checkExtendedGcd()
+{
+    for (int a = -30; a <= 30; ++a)
+    {
+        for (int b = -30; b <= 30; ++b)
+        {
+            auto [g, x, y] = extendedGcd(a, b);
+            if (a * x + b * y != g || g < 0)
+                return false;
+            if (g != 0 && (a % g != 0 || b % g != 0))
+                return false;
+        }
+    }
+    return std::get<0>(extendedGcd(12, 18)) == 6 && std::get<0>(extendedGcd(0, -5)) == 5;
+}
+static_assert(checkExtendedGcd());
+
+constexpr bool checkChineseRemainder()
+{
+    for (int m = 1; m <= 12; ++m)
+    {
+        for (int n = 1; n <= 12; ++n)
+        {
+            for (int a = 0; a < m; ++a)
+            {
+                for (int b = 0; b < n; ++b)
+                {
+                    auto solved = chineseRemainder(a, m, b, n);
+                    auto [g, p, q] = extendedGcd(m, n);
+                    if (solved.has_value() != ((b - a) % g == 0))
+                        return false;
+                    if (!solved)
+                        continue;
+                    auto [x, modulus] = *solved;
+                    if (modulus != m / g * n || x < 0 || x >= modulus)
+                        return false;
+                    if (x % m != a || x % n != b)
+                        return false;
+                }
+            }
+        }
+    }
+    return chineseRemainder(13, 101, 79, 103) == std::pair{7083, 10403};
 }
+static_assert(checkChineseRemainder());
+}  // namespace detail
 
-} //  namespace aoc2024::util
\ No newline at end of file
+} //  namespace aoc2024::util
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace aoc2024::util::parallel
+{
+/**
+ * Number of workers used to process `count` independent work items:
+ * never more than there are items or hardware threads, and at least one.
+ */
+inline std::size_t workerCount(std::size_t count)
+{
+    auto hardware = std::max(
+        std::size_t{1}, static_cast<std::size_t>(std::thread::hardware_concurrency()));
+    return std::clamp(count, std::size_t{1}, hardware);
+}
+
+/**
+ * Invokes `func(index, worker)` for every index in [0, count).
+ * Indices are handed out one at a time, so work items of uneven cost still
+ * balance across threads. `worker` is in [0, workerCount(count)) and is meant
+ * to address per-thread state (e.g. partial results reduced afterwards).
+ * The calling thread participates as worker 0.
+ */
+void forEachIndex(std::size_t count, auto&& func)
+{
+    std::atomic<std::size_t> next = 0;
+    auto work = [&](std::size_t worker)
+    {
+        for (auto index = next.fetch_add(1, std::memory_order_relaxed); index < count;
+             index = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            func(index, worker);
+        }
+    };
+
+    auto workers = workerCount(count);
+    std::vector<std::jthread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t worker = 1; worker < workers; ++worker)
+        threads.emplace_back(work, worker);
+    work(0);
+}
+
+/**
+ * Splits [0, count) into consecutive chunks of at most `chunkSize` items,
+ * evaluates `func(begin, end)` for each chunk in parallel and folds the
+ * results with `reduce`. `identity` seeds every per-worker partial, so it must
+ * be neutral for `reduce`; chunks may be combined in any order.
+ */
+template <typename T, typename Reduce = std::plus<>>
+T reduceChunks(std::size_t count,
+               std::size_t chunkSize,
+               T identity,
+               auto&& func,
+               Reduce reduce = {})
+{
+    auto chunks = (count + chunkSize - 1) / chunkSize;
+    std::vector<T> partial(workerCount(chunks), identity);
+    forEachIndex(chunks,
+                 [&](std::size_t chunk, std::size_t worker)
+                 {
+                     auto begin = chunk * chunkSize;
+                     auto end = std::min(begin + chunkSize, count);
+                     partial[worker] = reduce(std::move(partial[worker]), func(begin, end));
+                 });
+
+    for (auto& value : partial)
+        identity = reduce(std::move(identity), std::move(value));
+    return identity;
+}
+
+}  // namespace aoc2024::util::parallel
@@ -6,4 +6,5 @@
 #include "position.h"
 #include "numeric.h"
 #include "functional.h"
+#include "parallel.h"
 